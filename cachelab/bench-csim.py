@@ -0,0 +1,137 @@
+#!/usr/bin/env python
+#
+# bench-csim.py - Measure the throughput of csim, in simulated accesses
+#     per second, on synthetic traces written by ./tracesynth.  Every
+#     configuration pairs an access pattern with a cache geometry and
+#     is timed several times, keeping the fastest run.  Results can be
+#     saved and later compared against, so that speed regressions of
+#     the simulator are caught.
+#
+from __future__ import print_function
+import subprocess
+import re
+import os
+import sys
+import time
+import json
+import tempfile
+import optparse
+
+#
+# Configurations: name, tracesynth arguments and csim arguments
+#
+CONFIGS = [
+    ("seq-l1",       "-p seq -w 1m",             "-s 6 -E 8 -b 6"),
+    ("stride-l1",    "-p stride -s 4k -w 64m",   "-s 6 -E 8 -b 6"),
+    ("random-l2",    "-p random -w 64m -r 0.3",  "-s 10 -E 8 -b 6"),
+    ("zipf-l2",      "-p zipf -w 64m -r 0.3",    "-s 10 -E 8 -b 6"),
+    ("chase-llc",    "-p chase -w 256m",         "-s 14 -E 16 -b 6"),
+    ("transpose-dm", "-p transpose -w 8m",       "-s 5 -E 1 -b 5"),
+    ("random-lru",   "-p random -w 64m",         "-p lru -s 10 -E 8 -b 6"),
+    ("random-text",  "-p random -w 64m",         "-s 10 -E 8 -b 6"),
+]
+
+#
+# makeTrace - Write the trace of one configuration unless it exists,
+#     in the binary format except for the -text configurations, which
+#     also time the lackey parser
+#
+def makeTrace(name, gen_args, accesses, trace_dir):
+    binary = not name.endswith("-text")
+    path = os.path.join(trace_dir, "%s-%d.%s" %
+                        (name, accesses, "btrace" if binary else "trace"))
+    if os.path.exists(path):
+        return path
+    cmd = ["./tracesynth"] + gen_args.split() + \
+          ["-n", str(accesses), "-o", path] + (["-b"] if binary else [])
+    if subprocess.call(cmd) != 0:
+        sys.exit("bench-csim: %s failed" % " ".join(cmd))
+    return path
+
+#
+# runCsim - Time one run of csim; returns the seconds taken and the
+#     number of accesses it simulated
+#
+def runCsim(csim_args, path):
+    cmd = ["./csim"] + csim_args.split() + ["-t", path]
+    start = time.time()
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE)
+    stdout_data = p.communicate()[0].decode()
+    seconds = time.time() - start
+    m = re.search(r'hits:(\d+) misses:(\d+)', stdout_data)
+    if p.returncode != 0 or not m:
+        sys.exit("bench-csim: %s failed" % " ".join(cmd))
+    return seconds, int(m.group(1)) + int(m.group(2))
+
+#
+# main - Main function
+#
+def main():
+
+    # Parse the command line arguments
+    p = optparse.OptionParser()
+    p.add_option("-n", type="int", dest="accesses", default=4000000,
+                 help="data accesses per trace (default 4000000)")
+    p.add_option("-r", type="int", dest="runs", default=3,
+                 help="timed runs per configuration (default 3)")
+    p.add_option("-d", dest="trace_dir", default=None,
+                 help="keep the traces in this directory for reuse")
+    p.add_option("-c", dest="only", default=None,
+                 help="run only the configurations matching this regex")
+    p.add_option("-s", dest="save", default=None,
+                 help="save the results to this JSON file")
+    p.add_option("-b", dest="baseline", default=None,
+                 help="compare against results saved with -s")
+    p.add_option("-t", type="float", dest="tolerance", default=10.0,
+                 help="percent slowdown that counts as a regression")
+    opts, args = p.parse_args()
+
+    trace_dir = opts.trace_dir or tempfile.mkdtemp(prefix="bench-csim-")
+    if not os.path.isdir(trace_dir):
+        os.makedirs(trace_dir)
+    baseline = {}
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            baseline = json.load(f)
+
+    results = {}
+    regressions = 0
+    print("%-14s%12s%10s%12s%10s" %
+          ("Config", "Accesses", "Seconds", "Macc/s", "Change"))
+    for name, gen_args, csim_args in CONFIGS:
+        if opts.only and not re.search(opts.only, name):
+            continue
+        path = makeTrace(name, gen_args, opts.accesses, trace_dir)
+        best = None
+        for i in range(opts.runs):
+            seconds, accesses = runCsim(csim_args, path)
+            if best is None or seconds < best:
+                best = seconds
+        rate = accesses / best / 1e6
+        results[name] = rate
+
+        change = ""
+        if name in baseline:
+            percent = (rate / baseline[name] - 1) * 100
+            change = "%+.1f%%" % percent
+            if percent < -opts.tolerance:
+                change += " !"
+                regressions += 1
+        print("%-14s%12d%10.3f%12.2f%10s" %
+              (name, accesses, best, rate, change))
+
+    if not opts.trace_dir:
+        for f in os.listdir(trace_dir):
+            os.remove(os.path.join(trace_dir, f))
+        os.rmdir(trace_dir)
+    if opts.save:
+        with open(opts.save, "w") as f:
+            json.dump(results, f, indent=1, sort_keys=True)
+    if regressions:
+        print("%d configuration(s) slower than the baseline by more than "
+              "%.0f%%" % (regressions, opts.tolerance))
+        sys.exit(1)
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
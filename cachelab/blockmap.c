@@ -0,0 +1,190 @@
+/*
+ * blockmap.c - Hash map from block numbers to 64-bit counters
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "blockmap.h"
+
+#define BLOCKMAP_MIN_CAPACITY 64
+
+/*
+ * slotOf - Home slot of key.  Block numbers are often multiples of a
+ *     power of two, so the key is scrambled by a multiplicative hash.
+ */
+static inline size_t slotOf(const blockmap_t* map, mem_addr_t key)
+{
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & (map->capacity - 1);
+}
+
+/*
+ * allocSlots - Allocate capacity empty slots. Returns 0 on success
+ */
+static int allocSlots(blockmap_t* map, size_t capacity)
+{
+    map->keys = malloc(capacity * sizeof(mem_addr_t));
+    map->values = malloc(capacity * sizeof(unsigned long long int));
+    map->used = calloc(capacity, 1);
+    map->capacity = capacity;
+    if (!map->keys || !map->values || !map->used) {
+        freeBlockmap(map);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * initBlockmap - Create an empty map
+ */
+int initBlockmap(blockmap_t* map)
+{
+    memset(map, 0, sizeof(blockmap_t));
+    return allocSlots(map, BLOCKMAP_MIN_CAPACITY);
+}
+
+/*
+ * freeBlockmap - free allocated memory
+ */
+void freeBlockmap(blockmap_t* map)
+{
+    free(map->keys);
+    free(map->values);
+    free(map->used);
+    memset(map, 0, sizeof(blockmap_t));
+}
+
+/*
+ * grow - Double the number of slots and rehash every key
+ */
+static int grow(blockmap_t* map)
+{
+    blockmap_t old = *map;
+    size_t i;
+
+    if (allocSlots(map, old.capacity * 2) < 0) {
+        *map = old;
+        return -1;
+    }
+    map->count = old.count;
+    for (i = 0; i < old.capacity; i++) {
+        size_t slot;
+        if (!old.used[i])
+            continue;
+        slot = slotOf(map, old.keys[i]);
+        while (map->used[slot])
+            slot = (slot + 1) & (map->capacity - 1);
+        map->used[slot] = 1;
+        map->keys[slot] = old.keys[i];
+        map->values[slot] = old.values[i];
+    }
+    freeBlockmap(&old);
+    return 0;
+}
+
+/*
+ * blockmapFind - Return the value stored for key, or NULL
+ */
+unsigned long long int* blockmapFind(const blockmap_t* map, mem_addr_t key)
+{
+    size_t slot = slotOf(map, key);
+
+    while (map->used[slot]) {
+        if (map->keys[slot] == key)
+            return &map->values[slot];
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    return NULL;
+}
+
+/*
+ * blockmapInsert - Find key, adding it with the value 0 if missing
+ */
+unsigned long long int* blockmapInsert(blockmap_t* map, mem_addr_t key,
+                                       int* created)
+{
+    size_t slot;
+
+    /* keep the load factor at or below 1/2 */
+    if ((map->count + 1) * 2 > map->capacity && grow(map) < 0)
+        return NULL;
+
+    slot = slotOf(map, key);
+    while (map->used[slot]) {
+        if (map->keys[slot] == key) {
+            if (created)
+                *created = 0;
+            return &map->values[slot];
+        }
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    map->used[slot] = 1;
+    map->keys[slot] = key;
+    map->values[slot] = 0;
+    map->count++;
+    if (created)
+        *created = 1;
+    return &map->values[slot];
+}
+
+/*
+ * blockmapRemove - Remove key, shifting later entries of its probe
+ *     run back so that no tombstones are needed.
+ */
+void blockmapRemove(blockmap_t* map, mem_addr_t key)
+{
+    size_t mask = map->capacity - 1;
+    size_t hole = slotOf(map, key);
+    size_t slot;
+
+    while (map->used[hole] && map->keys[hole] != key)
+        hole = (hole + 1) & mask;
+    if (!map->used[hole])
+        return;
+
+    map->used[hole] = 0;
+    map->count--;
+    for (slot = (hole + 1) & mask; map->used[slot]; slot = (slot + 1) & mask) {
+        size_t home = slotOf(map, map->keys[slot]);
+        /* move the entry into the hole unless its home lies after the
+           hole in the circular run */
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            map->keys[hole] = map->keys[slot];
+            map->values[hole] = map->values[slot];
+            map->used[hole] = 1;
+            map->used[slot] = 0;
+            hole = slot;
+        }
+    }
+}
+
+/*
+ * blockmapRecord - Find the record of key in an array of records of
+ *     size bytes, whose positions the map holds.  A key seen for the
+ *     first time gets a zeroed record appended, the array doubling when
+ *     full.  Returns the array, which may have moved, with *index set
+ *     to the record, or NULL with the array untouched if out of memory.
+ */
+void* blockmapRecord(blockmap_t* map, mem_addr_t key, void* records,
+                     size_t size, size_t* count, size_t* capacity,
+                     size_t* index, int* created)
+{
+    unsigned long long int* value = blockmapInsert(map, key, created);
+
+    if (!value)
+        return NULL;
+    if (*created) {
+        if (*count == *capacity) {
+            size_t grown = *capacity ? 2 * *capacity : 256;
+            void* moved = realloc(records, grown * size);
+            if (!moved) {
+                blockmapRemove(map, key);
+                return NULL;
+            }
+            records = moved;
+            *capacity = grown;
+        }
+        memset((char*)records + *count * size, 0, size);
+        *value = (*count)++;
+    }
+    *index = *value;
+    return records;
+}
@@ -0,0 +1,50 @@
+/*
+ * blockmap.h - Hash map from block (or page, or PC) numbers to
+ *     64-bit counters, used by the csim modes that track state per
+ *     distinct block rather than per cache line.
+ */
+#ifndef CSIM_BLOCKMAP_H
+#define CSIM_BLOCKMAP_H
+
+#include <stddef.h>
+#include "trace.h"
+
+/* Type: Open-addressing hash map with linear probing */
+typedef struct blockmap {
+    mem_addr_t* keys;
+    unsigned long long int* values;
+    unsigned char* used;
+    size_t capacity; /* always a power of two */
+    size_t count;
+} blockmap_t;
+
+/* initBlockmap - Create an empty map. Returns 0 on success */
+int initBlockmap(blockmap_t* map);
+
+/* freeBlockmap - free allocated memory */
+void freeBlockmap(blockmap_t* map);
+
+/* blockmapFind - Return the value stored for key, or NULL */
+unsigned long long int* blockmapFind(const blockmap_t* map, mem_addr_t key);
+
+/*
+ * blockmapInsert - Return the value stored for key, adding it with the
+ *     value 0 if it is not in the map yet.  *created tells which.
+ */
+unsigned long long int* blockmapInsert(blockmap_t* map, mem_addr_t key,
+                                       int* created);
+
+/* blockmapRemove - Remove key from the map if present */
+void blockmapRemove(blockmap_t* map, mem_addr_t key);
+
+/*
+ * blockmapRecord - Find or append the record of key in an array of
+ *     records of size bytes indexed by the map, growing the array by
+ *     doubling.  Returns the array, which may have moved, and sets
+ *     *index and *created, or returns NULL if out of memory.
+ */
+void* blockmapRecord(blockmap_t* map, mem_addr_t key, void* records,
+                     size_t size, size_t* count, size_t* capacity,
+                     size_t* index, int* created);
+
+#endif /* CSIM_BLOCKMAP_H */
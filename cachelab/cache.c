@@ -0,0 +1,708 @@
+/*
+ * cache.c - The cache model simulated by csim.  The replacement
+ *     policies live in policy.c; MRU is the default.
+ */
+#define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE /* for MADV_HUGEPAGE */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "cache.h"
+#include "missclass.h"
+#include "victim.h"
+
+/* Accesses between prefetching a set and simulating the access to it */
+#define CACHE_PREFETCH_DISTANCE 16
+/* Accesses whose set indices accessBatch() computes at once */
+#define CACHE_BATCH_CHUNK 256
+/* Storage at least this large is backed by huge pages where possible */
+#define CACHE_HUGE_PAGE (1 << 21)
+
+static const char* index_names[] = { "modulo", "xor", "prime", "skew" };
+
+/*
+ * findIndexing - Look up a set index function by name
+ */
+int findIndexing(const char* name)
+{
+    for (int i = INDEX_MODULO; i <= INDEX_SKEW; i++)
+        if (strcmp(name, index_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*
+ * largestPrime - Largest prime not above n (n itself if below 3)
+ */
+static int largestPrime(int n)
+{
+    for (; n > 2; n--) {
+        int d;
+        for (d = 2; d * d <= n && n % d; d++)
+            ;
+        if (d * d > n)
+            return n;
+    }
+    return n;
+}
+
+/* 
+ * initCache - Allocate memory, write 0's for valid and tag, set up the
+ * replacement metadata, and compute the set_index_mask
+ */
+int initCache(cache_t* cache, int s, int E, int b,
+              const cache_policy_t* policy) {
+    return initCacheIndexed(cache, s, E, b, policy, INDEX_MODULO);
+}
+
+/*
+ * initCacheIndexed - initCache() with a choice of set index function
+ */
+int initCacheIndexed(cache_t* cache, int s, int E, int b,
+                     const cache_policy_t* policy, cache_index_t indexing)
+{
+    return initCacheSectored(cache, s, E, b, policy, indexing, b);
+}
+
+/*
+ * initCacheSectored - initCacheIndexed() with sectors of 2^k bytes
+ */
+int initCacheSectored(cache_t* cache, int s, int E, int b,
+                      const cache_policy_t* policy, cache_index_t indexing,
+                      int k)
+{
+    size_t tag_bytes, sector_bytes, valid_bytes, meta_bytes, total_bytes;
+
+    if (!policy)
+        policy = findPolicy("mru");
+    if (s < 0 || b < 0 || E < 1 || s + b > 63 || s > 30 ||
+        k < 0 || k > b || b - k > 6 || policy->metaSize(E) < 0)
+        return -1;
+
+    memset(cache, 0, sizeof(cache_t));
+    cache->s = s;
+    cache->E = E;
+    cache->b = b;
+    cache->S = 1 << s;
+    cache->B = 1 << b;
+    cache->set_index_mask = cache->S - 1;
+    cache->sector_bits = k;
+    cache->sectors = 1 << (b - k);
+    cache->indexing = indexing;
+    cache->tag_shift = indexing == INDEX_MODULO ? s + b : b;
+    if (indexing == INDEX_PRIME)
+        cache->S = largestPrime(cache->S);
+    cache->policy = policy;
+    cache->tag_stride = (E + CACHE_TAG_ALIGN - 1) & ~(CACHE_TAG_ALIGN - 1);
+    cache->valid_words = (E + 63) / 64;
+    /* a skewed cache keeps an LRU stamp per line instead */
+    cache->meta_size = indexing == INDEX_SKEW
+                       ? cache->tag_stride * (int)sizeof(unsigned long long)
+                       : policy->metaSize(E);
+    cache->rng = 0x2545f4914f6cdd1dULL;
+    cache->write_back = 1;
+    cache->write_allocate = 1;
+
+    /* allocate space for cache: tags first so that they stay aligned */
+    tag_bytes = (size_t)cache->S * cache->tag_stride * sizeof(mem_addr_t);
+    /* valid and dirty sector masks of every line, if sectored */
+    sector_bytes = cache->sectors > 1
+                   ? 2 * (size_t)cache->S * cache->tag_stride *
+                     sizeof(unsigned long long)
+                   : 0;
+    /* valid and dirty bitmasks */
+    valid_bytes = 2 * (size_t)cache->S * cache->valid_words *
+                  sizeof(unsigned long long);
+    meta_bytes = (size_t)cache->S * cache->meta_size;
+    total_bytes = tag_bytes + sector_bytes + valid_bytes + meta_bytes;
+    if (posix_memalign(&cache->storage,
+                       total_bytes >= CACHE_HUGE_PAGE ? CACHE_HUGE_PAGE : 64,
+                       total_bytes) != 0) {
+        cache->storage = NULL;
+        return -1;
+    }
+#ifdef MADV_HUGEPAGE
+    /* an access touches the tag, bit and metadata arrays, which lie far
+       apart in a large cache; huge pages save a page walk for each */
+    if (total_bytes >= CACHE_HUGE_PAGE)
+        madvise(cache->storage, total_bytes, MADV_HUGEPAGE);
+#endif
+    /* initialize all valid bits and tags to 0 */
+    memset(cache->storage, 0, total_bytes);
+    cache->tags = cache->storage;
+    if (sector_bytes) {
+        cache->sector_valid =
+            (unsigned long long*)((char*)cache->storage + tag_bytes);
+        cache->sector_dirty =
+            cache->sector_valid + (size_t)cache->S * cache->tag_stride;
+    }
+    cache->valid = (unsigned long long*)((char*)cache->storage + tag_bytes +
+                                         sector_bytes);
+    cache->dirty = cache->valid + (size_t)cache->S * cache->valid_words;
+    cache->meta = (unsigned char*)cache->storage + tag_bytes + sector_bytes +
+                  valid_bytes;
+
+    if (indexing != INDEX_SKEW)
+        for (int currentSet = 0; currentSet < cache->S; currentSet++)
+            policy->init(cache, cache->meta + currentSet * cache->meta_size);
+    return 0;
+}
+
+/*
+ * resetCache - Invalidate every line, set up the replacement metadata
+ *     again and clear the counters
+ */
+void resetCache(cache_t* cache)
+{
+    size_t bytes = (size_t)cache->S *
+                   (cache->tag_stride * sizeof(mem_addr_t) +
+                    2 * cache->valid_words * sizeof(unsigned long long) +
+                    cache->meta_size);
+
+    if (cache->sector_valid)
+        bytes += 2 * (size_t)cache->S * cache->tag_stride *
+                 sizeof(unsigned long long);
+
+    memset(cache->storage, 0, bytes);
+    if (cache->indexing != INDEX_SKEW)
+        for (int currentSet = 0; currentSet < cache->S; currentSet++)
+            cache->policy->init(cache,
+                                cache->meta + currentSet * cache->meta_size);
+    cache->rng = 0x2545f4914f6cdd1dULL;
+    cache->clock = 0;
+    cache->evicted_dirty = 0;
+    resetCounters(cache);
+}
+
+/*
+ * resetCounters - Clear the statistics counters, keeping the contents
+ */
+void resetCounters(cache_t* cache)
+{
+    cache->hit_count = 0;
+    cache->miss_count = 0;
+    cache->eviction_count = 0;
+    cache->writeback_count = 0;
+    cache->bytes_from_next = 0;
+    cache->bytes_to_next = 0;
+    cache->sector_miss_count = 0;
+}
+
+
+/* 
+ * freeCache - free allocated memory
+ */
+void freeCache(cache_t* cache)
+{
+    free(cache->storage);
+    cache->storage = NULL;
+    cache->tags = NULL;
+    cache->valid = NULL;
+    cache->dirty = NULL;
+    cache->meta = NULL;
+    cache->sector_valid = NULL;
+    cache->sector_dirty = NULL;
+}
+
+/*
+ * matchTags - Bitmask of the ways among the n (at most 64, padded to
+ *     CACHE_TAG_ALIGN) tags at tags that equal tag
+ */
+static inline unsigned long long matchTags(const mem_addr_t* tags, int n,
+                                           mem_addr_t tag)
+{
+    unsigned long long match = 0;
+    int way;
+
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x((long long)tag);
+    for (way = 0; way < n; way += 4) {
+        __m256i row = _mm256_load_si256((const __m256i*)(tags + way));
+        __m256i eq = _mm256_cmpeq_epi64(row, key);
+        match |= (unsigned long long)
+                 _mm256_movemask_pd(_mm256_castsi256_pd(eq)) << way;
+    }
+#elif defined(__SSE2__)
+    /* SSE2 has no 64-bit compare: both 32-bit halves must be equal */
+    __m128i key = _mm_set1_epi64x((long long)tag);
+    for (way = 0; way < n; way += 2) {
+        __m128i row = _mm_load_si128((const __m128i*)(tags + way));
+        __m128i eq = _mm_cmpeq_epi32(row, key);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        match |= (unsigned long long)
+                 _mm_movemask_pd(_mm_castsi128_pd(eq)) << way;
+    }
+#else
+    for (way = 0; way < n; way++)
+        match |= (unsigned long long)(tags[way] == tag) << way;
+#endif
+    return match;
+}
+
+/*
+ * findWay - Way of the set holding tag, or -1 if it is not cached
+ */
+static inline int findWay(const cache_t* cache, const mem_addr_t* tags,
+                          const unsigned long long* valid, mem_addr_t tag)
+{
+    for (int word = 0; word < cache->valid_words; word++) {
+        int n = cache->tag_stride - 64 * word;
+        unsigned long long match;
+
+        match = matchTags(tags + 64 * word, n < 64 ? n : 64, tag) &
+                valid[word];
+        if (match)
+            return 64 * word + __builtin_ctzll(match);
+    }
+    return -1;
+}
+
+/*
+ * findFree - Lowest invalid way of the set, or -1 if it is full
+ */
+static inline int findFree(const cache_t* cache,
+                           const unsigned long long* valid)
+{
+    for (int word = 0; word < cache->valid_words; word++) {
+        unsigned long long free_ways = ~valid[word];
+        int way;
+
+        if (!free_ways)
+            continue;
+        way = 64 * word + __builtin_ctzll(free_ways);
+        return way < cache->E ? way : -1;
+    }
+    return -1;
+}
+
+/*
+ * sectorLine - Index of the line of addr in way among all lines, as
+ *     used by the sector masks
+ */
+static inline size_t sectorLine(const cache_t* cache, mem_addr_t addr,
+                                int way)
+{
+    return (size_t)cacheSet(cache, addr, way) * cache->tag_stride + way;
+}
+
+/*
+ * sectorBit - Bit of the sector of addr in the sector masks of its line
+ */
+static inline unsigned long long sectorBit(const cache_t* cache,
+                                           mem_addr_t addr)
+{
+    return 1ULL << ((addr >> cache->sector_bits) & (cache->sectors - 1));
+}
+
+/*
+ * fillSectors - Start the sector masks of a line just filled in way
+ *     with the sector of addr, remembering the dirty sectors of the
+ *     line it replaced
+ */
+static inline void fillSectors(cache_t* cache, mem_addr_t addr, int way,
+                               int result)
+{
+    size_t line;
+
+    if (!cache->sector_valid)
+        return;
+    line = sectorLine(cache, addr, way);
+    cache->evicted_dirty =
+        result == FILL_EVICT_DIRTY ? cache->sector_dirty[line] : 0;
+    cache->sector_valid[line] = sectorBit(cache, addr);
+    cache->sector_dirty[line] = 0;
+}
+
+/*
+ * skewFind - Way holding the block of addr in a skewed cache, or -1,
+ *     looking at the line the block maps to in every way
+ */
+static int skewFind(const cache_t* cache, mem_addr_t addr)
+{
+    mem_addr_t block = addr >> cache->b;
+
+    for (int way = 0; way < cache->E; way++) {
+        mem_addr_t set = cacheSet(cache, addr, way);
+        if ((cache->valid[set * cache->valid_words + way / 64] >>
+             (way % 64) & 1) &&
+            cache->tags[set * cache->tag_stride + way] == block)
+            return way;
+    }
+    return -1;
+}
+
+/*
+ * skewStamp - LRU stamp of the line of addr in way of a skewed cache
+ */
+static inline unsigned long long* skewStamp(const cache_t* cache,
+                                            mem_addr_t addr, int way)
+{
+    return (unsigned long long*)(cache->meta +
+                                 cacheSet(cache, addr, way) *
+                                 cache->meta_size) + way;
+}
+
+/*
+ * skewFill - fillCache() for a skewed cache: use an empty candidate
+ *     line, or else the least recently used one
+ */
+static int skewFill(cache_t* cache, mem_addr_t addr, mem_addr_t* evicted)
+{
+    int way, victim = -1;
+    unsigned long long oldest = ~0ULL;
+    mem_addr_t set;
+    unsigned long long bit;
+    int result = FILL_EMPTY;
+
+    for (way = 0; way < cache->E; way++) {
+        unsigned long long stamp;
+
+        set = cacheSet(cache, addr, way);
+        if (!(cache->valid[set * cache->valid_words + way / 64] >>
+              (way % 64) & 1)) {
+            victim = way;
+            oldest = 0;
+            break;
+        }
+        stamp = *skewStamp(cache, addr, way);
+        if (stamp < oldest) {
+            oldest = stamp;
+            victim = way;
+        }
+    }
+    way = victim;
+    set = cacheSet(cache, addr, way);
+    bit = 1ULL << (way % 64);
+    if (cache->valid[set * cache->valid_words + way / 64] & bit) {
+        if (evicted)
+            *evicted = cache->tags[set * cache->tag_stride + way] << cache->b;
+        result = cache->dirty[set * cache->valid_words + way / 64] & bit
+                 ? FILL_EVICT_DIRTY : FILL_EVICT;
+    }
+    cache->valid[set * cache->valid_words + way / 64] |= bit;
+    cache->dirty[set * cache->valid_words + way / 64] &= ~bit;
+    cache->tags[set * cache->tag_stride + way] = addr >> cache->b;
+    *skewStamp(cache, addr, way) = ++cache->clock;
+    fillSectors(cache, addr, way, result);
+    return result;
+}
+
+/*
+ * probeCache - Look up the block of addr.  On a hit the replacement
+ *     state is updated and the way is returned, otherwise -1.
+ */
+int probeCache(cache_t* cache, mem_addr_t addr)
+{
+    /* get set index and bitwise-and with mask */
+    mem_addr_t setIndex = cacheSet(cache, addr, 0);
+    /* get cache tag */
+    mem_addr_t currentTag = addr >> cache->tag_shift;
+    int way;
+
+    if (cache->indexing == INDEX_SKEW) {
+        way = skewFind(cache, addr);
+        if (way >= 0)
+            *skewStamp(cache, addr, way) = ++cache->clock;
+        return way;
+    }
+
+    /* compare all ways at once; a valid match is a hit */
+    way = findWay(cache, cache->tags + setIndex * cache->tag_stride,
+                  cache->valid + setIndex * cache->valid_words, currentTag);
+    if (way >= 0)
+        cache->policy->hit(cache, cache->meta + setIndex * cache->meta_size,
+                           way);
+    return way;
+}
+
+/*
+ * lookupCache - Way holding the block of addr, or -1 if it is not
+ *     cached, without touching the replacement state
+ */
+int lookupCache(const cache_t* cache, mem_addr_t addr)
+{
+    mem_addr_t setIndex = cacheSet(cache, addr, 0);
+
+    if (cache->indexing == INDEX_SKEW)
+        return skewFind(cache, addr);
+    return findWay(cache, cache->tags + setIndex * cache->tag_stride,
+                   cache->valid + setIndex * cache->valid_words,
+                   addr >> cache->tag_shift);
+}
+
+/*
+ * fillCache - Bring the block of addr, which must not be cached, into
+ *     the lowest empty line of its set or else into the policy's
+ *     victim.  The filled line is clean, and holds just the sector of
+ *     addr if it is sectored.  Returns FILL_EVICT or
+ *     FILL_EVICT_DIRTY and the address of the evicted block in
+ *     *evicted if a valid line was replaced, FILL_EMPTY otherwise.
+ */
+int fillCache(cache_t* cache, mem_addr_t addr, mem_addr_t* evicted)
+{
+    mem_addr_t setIndex = cacheSet(cache, addr, 0);
+    mem_addr_t* tags = cache->tags + setIndex * cache->tag_stride;
+    unsigned long long* valid = cache->valid + setIndex * cache->valid_words;
+    unsigned long long* dirty = cache->dirty + setIndex * cache->valid_words;
+    unsigned char* meta = cache->meta + setIndex * cache->meta_size;
+    unsigned long long bit;
+    int way, result = FILL_EMPTY;
+
+    if (cache->indexing == INDEX_SKEW)
+        return skewFill(cache, addr, evicted);
+    way = findFree(cache, valid);
+    if (way >= 0) {
+        bit = 1ULL << (way % 64);
+        valid[way / 64] |= bit;
+    } else {
+        way = cache->policy->victim(cache, meta);
+        bit = 1ULL << (way % 64);
+        /* a hashed cache keeps the whole block number as the tag */
+        if (evicted)
+            *evicted = cache->indexing == INDEX_MODULO
+                       ? (tags[way] << cache->tag_shift) | (setIndex << cache->b)
+                       : tags[way] << cache->b;
+        result = dirty[way / 64] & bit ? FILL_EVICT_DIRTY : FILL_EVICT;
+    }
+    dirty[way / 64] &= ~bit;
+    tags[way] = addr >> cache->tag_shift;
+    cache->policy->fill(cache, meta, way);
+    fillSectors(cache, addr, way, result);
+    return result;
+}
+
+/*
+ * markDirty - Mark way of the set of addr as modified.  With way -1
+ *     the way holding addr is looked up first, leaving the replacement
+ *     state alone.
+ */
+static void markDirty(cache_t* cache, mem_addr_t addr, int way)
+{
+    mem_addr_t setIndex;
+
+    if (way < 0)
+        way = lookupCache(cache, addr);
+    setIndex = cacheSet(cache, addr, way);
+    cache->dirty[setIndex * cache->valid_words + way / 64] |=
+        1ULL << (way % 64);
+    if (cache->sector_dirty)
+        cache->sector_dirty[setIndex * cache->tag_stride + way] |=
+            sectorBit(cache, addr);
+}
+
+/*
+ * hasSector - Whether way, which holds the block of addr, holds its
+ *     sector as well; always so for lines that are not sectored
+ */
+static inline int hasSector(const cache_t* cache, mem_addr_t addr, int way)
+{
+    return !cache->sector_valid ||
+           (cache->sector_valid[sectorLine(cache, addr, way)] &
+            sectorBit(cache, addr));
+}
+
+/*
+ * missSector - Count a sector miss and fetch the sector of addr into
+ *     way, which holds its block
+ */
+static void missSector(cache_t* cache, mem_addr_t addr, int way)
+{
+    cache->miss_count++;
+    cache->sector_miss_count++;
+    cache->bytes_from_next += 1ULL << cache->sector_bits;
+    cache->sector_valid[sectorLine(cache, addr, way)] |= sectorBit(cache, addr);
+}
+
+/*
+ * invalidateBlock - Drop the block of addr.  Returns 1 if it was cached.
+ */
+int invalidateBlock(cache_t* cache, mem_addr_t addr)
+{
+    int way = lookupCache(cache, addr);
+
+    if (way < 0)
+        return 0;
+    cache->valid[cacheSet(cache, addr, way) * cache->valid_words + way / 64] &=
+        ~(1ULL << (way % 64));
+    return 1;
+}
+
+/*
+ * fetchBlock - Bring the block of addr in from the victim cache or the
+ *     next level, passing an evicted line to the victim cache or
+ *     writing it back
+ */
+int fetchBlock(cache_t* cache, mem_addr_t addr, mem_addr_t* evicted,
+               int demand)
+{
+    victim_cache_t* vc = cache->victim;
+    mem_addr_t line;
+    int fill, result, found = 0, dirty = 0;
+
+    if (vc)
+        found = victimLookup(vc, addr >> cache->b, &dirty, demand);
+    if (!found)
+        cache->bytes_from_next += 1ULL << cache->sector_bits;
+    fill = result = fillCache(cache, addr, &line);
+    if (fill != FILL_EMPTY) {
+        cache->eviction_count++;
+        if (evicted)
+            *evicted = line;
+        /* a victim cache takes the evicted line, dirty or not */
+        if (vc && !vc->miss_cache) {
+            vc->swaps += found;
+            if (victimInsert(vc, line >> cache->b,
+                             fill == FILL_EVICT_DIRTY))
+                fill = FILL_EVICT_DIRTY;
+            else
+                fill = FILL_EVICT;
+        }
+        if (fill == FILL_EVICT_DIRTY) {
+            cache->writeback_count++;
+            /* a sectored line writes back its dirty sectors only */
+            cache->bytes_to_next += cache->sector_valid
+                ? (unsigned long long)__builtin_popcountll(
+                      cache->evicted_dirty) << cache->sector_bits
+                : (unsigned long long)cache->B;
+        }
+    }
+    if (vc && vc->miss_cache && !found)
+        victimInsert(vc, addr >> cache->b, 0);
+    if (dirty)
+        markDirty(cache, addr, -1);
+    return result;
+}
+
+/*
+ * missData - Count a miss and bring the block of addr in from the
+ *     next level, writing back a dirty victim
+ */
+static void missData(cache_t* cache, mem_addr_t addr)
+{
+    cache->miss_count++;
+    if (cache->classify)
+        missClassMiss(cache->classify, addr);
+    fetchBlock(cache, addr, NULL, 1);
+}
+
+/* 
+ * accessData - Access data at memory address addr.
+ *   If it is already in cache, increast hit_count
+ *   If it is not in cache, bring it in cache, increase miss count.
+ *   Also increase eviction_count if a line is evicted.
+ *   If only its sector is missing, fetch the sector, a miss as well.
+ */
+void accessData(cache_t* cache, mem_addr_t addr) {
+    int way;
+
+    if (cache->classify)
+        missClassAccess(cache->classify, addr);
+    way = probeCache(cache, addr);
+    if (way >= 0) {
+        if (hasSector(cache, addr, way))
+            cache->hit_count++;
+        else
+            missSector(cache, addr, way);
+        return;
+    }
+    missData(cache, addr);
+}
+
+/*
+ * writeData - Store size bytes at memory address addr.
+ *   Hits and misses are counted like loads.  A write-back cache marks
+ *   the line dirty, a write-through cache passes the bytes on at once.
+ *   Without write-allocate a store miss leaves the cache unchanged.
+ */
+void writeData(cache_t* cache, mem_addr_t addr, unsigned int size)
+{
+    int way;
+
+    if (cache->classify)
+        missClassAccess(cache->classify, addr);
+    way = probeCache(cache, addr);
+    if (way >= 0 && hasSector(cache, addr, way)) {
+        cache->hit_count++;
+    } else if (way >= 0 && cache->write_allocate) {
+        missSector(cache, addr, way);
+    } else if (cache->write_allocate) {
+        missData(cache, addr);
+    } else {
+        cache->miss_count++;
+        if (way >= 0)
+            cache->sector_miss_count++;
+        else if (cache->classify)
+            missClassMiss(cache->classify, addr);
+        cache->bytes_to_next += size;
+        return;
+    }
+    if (cache->write_back)
+        markDirty(cache, addr, way);
+    else
+        cache->bytes_to_next += size;
+}
+
+/*
+ * prefetchSet - Ask the host to start loading the tags, valid and
+ *     dirty bits and replacement metadata of a set
+ */
+static inline void prefetchSet(const cache_t* cache, mem_addr_t setIndex,
+                               int write)
+{
+    __builtin_prefetch(cache->tags + setIndex * cache->tag_stride, 1);
+    __builtin_prefetch(cache->valid + setIndex * cache->valid_words, 1);
+    if (write)
+        __builtin_prefetch(cache->dirty + setIndex * cache->valid_words, 1);
+    if (cache->meta_size)
+        __builtin_prefetch(cache->meta + setIndex * cache->meta_size, 1);
+    if (cache->sector_valid)
+        __builtin_prefetch(cache->sector_valid +
+                           setIndex * cache->tag_stride, 1);
+}
+
+/*
+ * accessBatch - Apply n trace records in order.  The set indices of a
+ *     chunk of records are computed first, and each set is prefetched
+ *     CACHE_PREFETCH_DISTANCE records before it is accessed, so that
+ *     the host's misses on large simulated caches overlap.
+ */
+void accessBatch(cache_t* cache, const trace_access_t* accesses, size_t n)
+{
+    mem_addr_t sets[CACHE_BATCH_CHUNK];
+
+    for (size_t start = 0; start < n; start += CACHE_BATCH_CHUNK) {
+        const trace_access_t* chunk = accesses + start;
+        size_t m = n - start < CACHE_BATCH_CHUNK ? n - start
+                                                 : CACHE_BATCH_CHUNK;
+        size_t i;
+
+        for (i = 0; i < m; i++)
+            sets[i] = cacheSet(cache, chunk[i].addr, 0);
+        for (i = 0; i < m && i < CACHE_PREFETCH_DISTANCE; i++)
+            prefetchSet(cache, sets[i], chunk[i].op != 'L');
+        for (i = 0; i < m; i++) {
+            size_t ahead = i + CACHE_PREFETCH_DISTANCE;
+            if (ahead < m)
+                prefetchSet(cache, sets[ahead], chunk[ahead].op != 'L');
+            accessTrace(cache, &chunk[i]);
+        }
+    }
+}
+
+/*
+ * accessTrace - Apply one trace record to the cache
+ */
+void accessTrace(cache_t* cache, const trace_access_t* access)
+{
+    /* instruction fetches do not touch the data cache */
+    if (access->op == 'I')
+        return;
+    /* a modify is a load followed by a store */
+    if (access->op != 'S')
+        accessData(cache, access->addr);
+    if (access->op != 'L')
+        writeData(cache, access->addr, access->size);
+}
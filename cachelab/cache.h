@@ -0,0 +1,262 @@
+/*
+ * cache.h - The cache model simulated by csim
+ *
+ * All state of one simulated cache lives in a cache_t, so several
+ * caches can be simulated side by side in one process.
+ *
+ * The lines are stored as a structure of arrays in one allocation:
+ * for every set a row of tags, bitmasks of valid and dirty ways and
+ * the replacement metadata of the policy.  Tag rows are padded to a
+ * multiple of CACHE_TAG_ALIGN so that all ways of a set can be
+ * compared with SIMD loads; padding ways are never valid.
+ *
+ * The set of a block is normally its low s bits.  Hashed indexing
+ * functions spread power-of-two strides over the sets instead:
+ *
+ *   xor    the s-bit chunks of the block number XORed together
+ *   prime  the block number modulo the largest prime not above 2^s,
+ *          which becomes the number of sets
+ *   skew   a different multiplicative hash for every way, so blocks
+ *          that collide in one way rarely collide in another.  A set
+ *          is then a row of storage rather than a group of blocks,
+ *          and the least recently used of the E candidate lines of
+ *          a block is replaced whatever the policy.
+ *
+ * Hashed caches store the whole block number as the tag, so evicted
+ * addresses can be recovered without inverting the hash.
+ *
+ * A sectored cache keeps one tag per line but fills and writes back
+ * its lines in sectors of 2^k bytes, with a valid and a dirty bit per
+ * sector.  An access whose block is cached but whose sector is not is
+ * a sector miss; it fetches the sector without evicting anything.
+ * The masks of all lines sit between the tags and the valid bits.
+ */
+#ifndef CSIM_CACHE_H
+#define CSIM_CACHE_H
+
+#include "trace.h"
+
+/* Tags per SIMD comparison group: one 256-bit AVX2 vector */
+#define CACHE_TAG_ALIGN 4
+
+typedef struct cache cache_t;
+struct miss_class;
+
+/* Type: Replacement policy */
+typedef struct cache_policy {
+    const char* name;
+    /* bytes of metadata per set, -1 if E is not supported */
+    int (*metaSize)(int E);
+    /* set up the metadata of an empty set */
+    void (*init)(cache_t* cache, unsigned char* meta);
+    /* a valid line was hit */
+    void (*hit)(cache_t* cache, unsigned char* meta, int way);
+    /* a line was just filled */
+    void (*fill)(cache_t* cache, unsigned char* meta, int way);
+    /* choose the line to evict from a full set */
+    int (*victim)(cache_t* cache, unsigned char* meta);
+} cache_policy_t;
+
+/* Type: Set index function */
+typedef enum { INDEX_MODULO, INDEX_XOR, INDEX_PRIME, INDEX_SKEW } cache_index_t;
+
+/* Results of fillCache() */
+#define FILL_EMPTY 0       /* an empty line was used */
+#define FILL_EVICT 1       /* a clean valid line was replaced */
+#define FILL_EVICT_DIRTY 2 /* a dirty valid line was replaced */
+
+/* Type: One simulated cache */
+struct cache {
+    /* Geometry */
+    int s; /* set index bits */
+    int E; /* associativity */
+    int b; /* block offset bits */
+    int S; /* number of sets */
+    int B; /* block size (bytes) */
+    mem_addr_t set_index_mask;
+    cache_index_t indexing;
+    int tag_shift; /* s+b, or b when the tag is the whole block number */
+    int sector_bits; /* sector offset bits, b if lines are not sectored */
+    int sectors;     /* sectors per line, at most 64 */
+
+    /* Storage, all carved out of one allocation */
+    void* storage;
+    mem_addr_t* tags;           /* tag_stride tags per set */
+    unsigned long long* valid;  /* valid_words bitmask words per set */
+    unsigned long long* dirty;  /* valid_words bitmask words per set */
+    unsigned char* meta;        /* meta_size bytes of policy state per set */
+    unsigned long long* sector_valid; /* sectored: a mask per line, or NULL */
+    unsigned long long* sector_dirty; /* sectored: a mask per line, or NULL */
+    int tag_stride;
+    int valid_words;
+    int meta_size;
+
+    /* Replacement */
+    const cache_policy_t* policy;
+    unsigned long long int rng; /* state of the random policy */
+    unsigned long long int clock; /* skew: accesses, for LRU stamps */
+
+    /* Write policy: write-back and write-allocate unless cleared */
+    int write_back;
+    int write_allocate;
+
+    /* Counters used to record cache statistics */
+    unsigned long long int hit_count;
+    unsigned long long int miss_count;
+    unsigned long long int eviction_count;
+    unsigned long long int writeback_count; /* dirty lines written back */
+    unsigned long long int bytes_from_next; /* bytes filled from below */
+    unsigned long long int bytes_to_next;   /* bytes written below */
+    unsigned long long int sector_miss_count; /* misses on cached blocks */
+    unsigned long long int evicted_dirty; /* dirty sectors of the latest
+                                             line evicted by fillCache() */
+
+    /* 3C classifier of the misses, NULL if not classifying */
+    struct miss_class* classify;
+    /* Victim or miss cache behind this cache, NULL if none */
+    struct victim_cache* victim;
+};
+
+/* findPolicy - Look up a replacement policy by name, NULL if unknown */
+const cache_policy_t* findPolicy(const char* name);
+
+/*
+ * findIndexing - Look up a set index function by name ("modulo",
+ *     "xor", "prime" or "skew"), -1 if unknown
+ */
+int findIndexing(const char* name);
+
+/*
+ * cacheSet - Set of the block of addr, in way for a skewed cache
+ */
+static inline mem_addr_t cacheSet(const cache_t* cache, mem_addr_t addr,
+                                  int way)
+{
+    mem_addr_t block = addr >> cache->b;
+    mem_addr_t set = 0;
+
+    switch (cache->indexing) {
+    case INDEX_MODULO:
+        return block & cache->set_index_mask;
+    case INDEX_XOR:
+        if (cache->s)
+            for (; block; block >>= cache->s)
+                set ^= block & cache->set_index_mask;
+        return set;
+    case INDEX_PRIME:
+        return block % cache->S;
+    case INDEX_SKEW:
+    default:
+        if (!cache->s)
+            return 0;
+        /* an odd multiplier per way */
+        set = 0x9e3779b97f4a7c15ULL + 2ULL * way * 0x632be59bd9b4e019ULL;
+        return (block * set) >> (64 - cache->s);
+    }
+}
+
+/*
+ * initCache - Allocate an empty cache with 2^s sets of E lines of
+ *     2^b bytes, replaced by policy (MRU if NULL).  The cache is
+ *     write-back and write-allocate.  Returns 0 on success.
+ */
+int initCache(cache_t* cache, int s, int E, int b,
+              const cache_policy_t* policy);
+
+/*
+ * initCacheIndexed - Like initCache(), with the given set index
+ *     function.  A prime-indexed cache has fewer than 2^s sets.
+ */
+int initCacheIndexed(cache_t* cache, int s, int E, int b,
+                     const cache_policy_t* policy, cache_index_t indexing);
+
+/*
+ * initCacheSectored - Like initCacheIndexed(), with lines made of
+ *     sectors of 2^k bytes (k from b-6 to b, where k = b gives plain
+ *     lines)
+ */
+int initCacheSectored(cache_t* cache, int s, int E, int b,
+                      const cache_policy_t* policy, cache_index_t indexing,
+                      int k);
+
+/*
+ * resetCache - Empty the cache and clear its counters, keeping its
+ *     geometry and policies
+ */
+void resetCache(cache_t* cache);
+
+/*
+ * resetCounters - Clear every statistics counter of the cache, leaving
+ *     its lines alone, e.g. after warming it up
+ */
+void resetCounters(cache_t* cache);
+
+/* freeCache - free allocated memory */
+void freeCache(cache_t* cache);
+
+/*
+ * probeCache - Look up the block of addr.  On a hit the replacement
+ *     state is updated and the way is returned, otherwise -1.
+ */
+int probeCache(cache_t* cache, mem_addr_t addr);
+
+/*
+ * lookupCache - Way holding the block of addr, or -1 if it is not
+ *     cached.  Unlike probeCache() the replacement state is left alone.
+ */
+int lookupCache(const cache_t* cache, mem_addr_t addr);
+
+/*
+ * fillCache - Bring the block of addr, which must not be cached, into
+ *     a clean line of the cache.  Of a sectored line only the sector
+ *     of addr becomes valid.  Returns FILL_EVICT or
+ *     FILL_EVICT_DIRTY and the address of the evicted block in
+ *     *evicted (if not NULL) when a valid line was replaced, else
+ *     FILL_EMPTY.
+ */
+int fillCache(cache_t* cache, mem_addr_t addr, mem_addr_t* evicted);
+
+/*
+ * fetchBlock - fillCache() the block of addr the way a miss does,
+ *     without counting the miss: it comes from the victim cache if that
+ *     holds it, else from the next level, and an evicted line moves to
+ *     the victim cache or is written back.  Updates the eviction,
+ *     writeback and traffic counters and returns like fillCache().
+ *     demand is 0 for a prefetch, which the victim cache does not
+ *     count as a lookup.
+ */
+int fetchBlock(cache_t* cache, mem_addr_t addr, mem_addr_t* evicted,
+               int demand);
+
+/* invalidateBlock - Drop the block of addr. Returns 1 if it was cached */
+int invalidateBlock(cache_t* cache, mem_addr_t addr);
+
+/*
+ * accessData - Load data at memory address addr, counting a hit, or
+ *     a miss and possibly an eviction, a writeback and the traffic to
+ *     the next level.  A sector miss counts as a miss.  The probe
+ *     and fill primitives above do not touch the counters.
+ */
+void accessData(cache_t* cache, mem_addr_t addr);
+
+/*
+ * writeData - Store size bytes at memory address addr, following the
+ *     write policy of the cache.  Counts like accessData().
+ */
+void writeData(cache_t* cache, mem_addr_t addr, unsigned int size);
+
+/*
+ * accessTrace - Apply one trace record to the cache: loads load,
+ *     stores store, modifies load and then store, instruction fetches
+ *     do not access the cache.
+ */
+void accessTrace(cache_t* cache, const trace_access_t* access);
+
+/*
+ * accessBatch - Apply n trace records in order, like accessTrace(),
+ *     prefetching the host memory of upcoming sets.  Fastest for
+ *     simulated caches much larger than the host's caches.
+ */
+void accessBatch(cache_t* cache, const trace_access_t* accesses, size_t n);
+
+#endif /* CSIM_CACHE_H */
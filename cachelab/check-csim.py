@@ -0,0 +1,143 @@
+#!/usr/bin/env python
+#
+# check-csim.py - Check that csim's other modes agree with plain runs
+#     of the same cache on the test traces: the binary trace format,
+#     geometry sweeps (-G), one-level hierarchies (-H), stack distances
+#     (-D), set sampling at rate 1 (-S 1) and a single time shard
+#     (-P 1) must all give the counts of a plain simulation, and
+#     traceconv must convert a text trace to binary and back without
+#     changing a record.
+#     Exits with status 1 if any check fails.
+#
+from __future__ import print_function
+import subprocess
+import re
+import os
+import sys
+import shutil
+import tempfile
+import optparse
+
+TRACES = ["traces/yi.trace", "traces/dave.trace", "traces/trans.trace",
+          "traces/long.trace"]
+
+# Geometries (s, E, b) the plain runs are compared at
+GEOMETRIES = [(1, 1, 1), (2, 4, 3), (4, 2, 4), (5, 1, 5)]
+
+# Largest associativity checked against -D
+STACK_MAX_E = 8
+
+#
+# runCsim - Run csim with args and return its output
+#
+def runCsim(args):
+    cmd = ["./csim"] + args
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE)
+    stdout_data = p.communicate()[0].decode()
+    if p.returncode != 0:
+        sys.exit("check-csim: %s failed" % " ".join(cmd))
+    return stdout_data
+
+#
+# counts - The hits, misses and evictions of the first line of output
+#     after prefix that reports them
+#
+def counts(output, prefix=""):
+    m = re.search(re.escape(prefix) +
+                  r'hits:(\d+) misses:(\d+) evictions:(\d+)', output)
+    if not m:
+        sys.exit("check-csim: no %scounts in output:\n%s" % (prefix, output))
+    return tuple(int(x) for x in m.groups())
+
+#
+# records - The (op, address, size) records of a lackey text trace
+#
+def records(path):
+    pattern = r'^(I| [LSM]) +([0-9a-fA-F]+),(\d+)[ \t]*$'
+    with open(path) as f:
+        return [(m.group(1), int(m.group(2), 16), int(m.group(3)))
+                for m in re.finditer(pattern, f.read(), re.M)]
+
+#
+# plain - Counts of a plain run of one geometry
+#
+def plain(trace, s, E, b, policy="lru"):
+    return counts(runCsim(["-p", policy, "-s", str(s), "-E", str(E),
+                           "-b", str(b), "-t", trace]))
+
+#
+# main - Main function
+#
+def main():
+
+    # Parse the command line arguments
+    p = optparse.OptionParser()
+    p.add_option("-v", action="store_true", dest="verbose", default=False,
+                 help="print every check, not just the failures")
+    opts, args = p.parse_args()
+
+    tmp_dir = tempfile.mkdtemp(prefix="check-csim-")
+    results = {"passed": 0, "failed": 0}
+
+    def check(name, got, want):
+        ok = got == want
+        results["passed" if ok else "failed"] += 1
+        if opts.verbose or not ok:
+            print("%-6s %s" % ("ok" if ok else "FAILED", name))
+            if not ok:
+                print("       got %s, want %s" % (got, want))
+
+    for trace in TRACES:
+        name = os.path.basename(trace)
+
+        # traceconv round trip
+        btrace = os.path.join(tmp_dir, name + ".btrace")
+        text = os.path.join(tmp_dir, name)
+        for conv in (["-i", trace, "-o", btrace],
+                     ["-d", "-i", btrace, "-o", text]):
+            if subprocess.call(["./traceconv"] + conv) != 0:
+                sys.exit("check-csim: traceconv %s failed" % " ".join(conv))
+        check("%s traceconv round trip" % name, records(text),
+              records(trace))
+
+        for s, E, b in GEOMETRIES:
+            geom = "s=%d E=%d b=%d" % (s, E, b)
+            want = plain(trace, s, E, b)
+            sEb = ["-s", str(s), "-E", str(E), "-b", str(b)]
+
+            check("%s %s binary trace" % (name, geom),
+                  plain(btrace, s, E, b), want)
+            check("%s %s -G" % (name, geom),
+                  counts(runCsim(["-G", "%d:%d:%d" % (s, E, b), "-p", "lru",
+                                  "-t", trace])), want)
+            check("%s %s -H" % (name, geom),
+                  counts(runCsim(["-H", "l1=%d:%d:%d" % (s, E, b),
+                                  "-p", "lru", "-t", trace]), "l1 "), want)
+            check("%s %s -S 1" % (name, geom),
+                  counts(runCsim(["-S", "1", "-p", "lru"] + sEb +
+                                 ["-t", trace])), want)
+            check("%s %s -P 1" % (name, geom),
+                  counts(runCsim(["-P", "1", "-p", "lru"] + sEb +
+                                 ["-t", trace])), want)
+            check("%s %s -S 1 -p mru" % (name, geom),
+                  counts(runCsim(["-S", "1", "-p", "mru"] + sEb +
+                                 ["-t", trace])),
+                  plain(trace, s, E, b, "mru"))
+
+        # one stack distance pass covers every E up to STACK_MAX_E
+        for s, b in set((s, b) for s, E, b in GEOMETRIES):
+            output = runCsim(["-D", str(STACK_MAX_E), "-s", str(s),
+                              "-b", str(b), "-t", trace])
+            for E in range(1, STACK_MAX_E + 1):
+                check("%s s=%d E=%d b=%d -D" % (name, s, E, b),
+                      counts(output, "E:%d " % E), plain(trace, s, E, b))
+
+    shutil.rmtree(tmp_dir)
+    print("%d checks passed, %d failed" %
+          (results["passed"], results["failed"]))
+    if results["failed"]:
+        sys.exit(1)
+
+# execute main only if called as a script
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,447 @@
+/*
+ * coherence.c - Multicore simulation with a snoopy MESI protocol
+ *
+ * Every trace is the access stream of one core, and every core has a
+ * private write-back cache of the same geometry.  The caches snoop a
+ * shared bus and keep each line in one of the MESI states:
+ *
+ *     M  valid and dirty
+ *     E  valid, clean and not shared
+ *     S  valid, clean and possibly held by other cores too
+ *     I  not cached
+ *
+ * A load miss issues a bus read: other copies become S (a modified
+ * copy is flushed first) and the new line is E if nobody else had it.
+ * A store miss issues a read-exclusive and a store hit on an S line
+ * an upgrade; both invalidate every other copy.
+ *
+ * A miss on a block the core lost to an invalidation is a coherence
+ * miss.  From the invalidation on, each core records which bytes of
+ * the block the other cores wrote; if the missing access touches none
+ * of them the miss is counted as false sharing.
+ *
+ * The traces are interleaved round-robin, one record per core and
+ * turn, or by timestamp: the core that has executed the fewest
+ * instructions ('I' records) goes next, so an instruction's data
+ * accesses stay together.  A trace without instruction records counts
+ * every access as one instruction.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "csim.h"
+#include "blockmap.h"
+
+/* Lines reported when not verbose */
+#define COHERENCE_TOP_LINES 10
+
+/* Type: Coherence events of one block */
+typedef struct line_stats {
+    mem_addr_t block;
+    unsigned long long int invalidations;
+    unsigned long long int coherence_misses;
+    unsigned long long int false_sharing;
+} line_stats_t;
+
+/* Type: One core with its trace and private cache */
+typedef struct core {
+    cache_t cache;
+    unsigned long long* shared; /* S state bits, laid out like cache.valid */
+    blockmap_t lost; /* invalidated blocks -> bytes written by others */
+
+    trace_reader_t* tr;
+    trace_access_t* batch;
+    size_t pos, len;
+    unsigned long long int clock; /* instructions executed */
+    int seen_instruction;
+
+    unsigned long long int invalidations; /* copies lost to other cores */
+    unsigned long long int coherence_misses;
+    unsigned long long int false_sharing;
+} core_t;
+
+/* Type: The whole system */
+typedef struct coherence {
+    core_t* cores;
+    int ncores;
+    int b;
+    int granule; /* bytes per bit of a written-bytes mask */
+
+    unsigned long long int bus_reads;
+    unsigned long long int bus_read_exclusives;
+    unsigned long long int bus_upgrades;
+    unsigned long long int flushes;
+
+    blockmap_t line_index; /* block -> index into lines */
+    line_stats_t* lines;
+    size_t nlines, lines_capacity;
+} coherence_t;
+
+/*
+ * lineStats - Statistics record of block, created on first use
+ */
+static line_stats_t* lineStats(coherence_t* sys, mem_addr_t block)
+{
+    line_stats_t* lines;
+    size_t index;
+    int created;
+
+    lines = blockmapRecord(&sys->line_index, block, sys->lines,
+                           sizeof(line_stats_t), &sys->nlines,
+                           &sys->lines_capacity, &index, &created);
+    if (!lines) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    sys->lines = lines;
+    if (created)
+        lines[index].block = block;
+    return &lines[index];
+}
+
+/*
+ * byteMask - Bits of the granules of its block an access touches
+ */
+static unsigned long long byteMask(const coherence_t* sys, mem_addr_t addr,
+                                   unsigned int size)
+{
+    unsigned int block_size = 1u << sys->b;
+    unsigned int first = addr & (block_size - 1);
+    unsigned int last = first + (size ? size : 1) - 1;
+
+    if (last >= block_size)
+        last = block_size - 1;
+    first /= sys->granule;
+    last /= sys->granule;
+    if (last - first == 63)
+        return ~0ULL;
+    return ((1ULL << (last - first + 1)) - 1) << first;
+}
+
+/*
+ * lineWord - Word holding the bit of way in one of the per-line
+ *     bitmasks of the cache
+ */
+static inline unsigned long long* lineWord(const cache_t* cache,
+                                           unsigned long long* bits,
+                                           mem_addr_t addr, int way)
+{
+    return bits + cacheSet(cache, addr, way) * cache->valid_words + way / 64;
+}
+
+/*
+ * flushLine - Write a modified line back so that it becomes clean
+ */
+static void flushLine(coherence_t* sys, core_t* core, mem_addr_t addr,
+                      int way)
+{
+    unsigned long long* dirty = lineWord(&core->cache, core->cache.dirty,
+                                         addr, way);
+    unsigned long long bit = 1ULL << (way % 64);
+
+    if (!(*dirty & bit))
+        return;
+    *dirty &= ~bit;
+    core->cache.writeback_count++;
+    core->cache.bytes_to_next += core->cache.B;
+    sys->flushes++;
+}
+
+/*
+ * invalidateOthers - Take the block of addr away from every core but c
+ */
+static void invalidateOthers(coherence_t* sys, int c, mem_addr_t addr)
+{
+    mem_addr_t block = addr >> sys->b;
+
+    for (int o = 0; o < sys->ncores; o++) {
+        core_t* other = &sys->cores[o];
+        unsigned long long* lost;
+        int way, created;
+
+        if (o == c || (way = lookupCache(&other->cache, addr)) < 0)
+            continue;
+        flushLine(sys, other, addr, way);
+        invalidateBlock(&other->cache, addr);
+        other->invalidations++;
+        lineStats(sys, block)->invalidations++;
+        lost = blockmapInsert(&other->lost, block, &created);
+        if (!lost) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        *lost = 0;
+    }
+}
+
+/*
+ * recordWrite - Note the bytes core c wrote in the blocks the other
+ *     cores lost
+ */
+static void recordWrite(coherence_t* sys, int c, mem_addr_t addr,
+                        unsigned long long mask)
+{
+    mem_addr_t block = addr >> sys->b;
+
+    for (int o = 0; o < sys->ncores; o++) {
+        unsigned long long* written;
+
+        if (o != c && (written = blockmapFind(&sys->cores[o].lost, block)))
+            *written |= mask;
+    }
+}
+
+/*
+ * coherentAccess - Load or store size bytes at addr on core c
+ */
+static void coherentAccess(coherence_t* sys, int c, mem_addr_t addr,
+                           unsigned int size, int write)
+{
+    core_t* core = &sys->cores[c];
+    cache_t* cache = &core->cache;
+    mem_addr_t block = addr >> sys->b;
+    unsigned long long mask = byteMask(sys, addr, size);
+    unsigned long long* written;
+    int way = probeCache(cache, addr);
+    int others = 0;
+
+    if (way >= 0) {
+        unsigned long long bit = 1ULL << (way % 64);
+
+        cache->hit_count++;
+        if (write && (*lineWord(cache, core->shared, addr, way) & bit)) {
+            /* S -> M needs every other copy gone */
+            sys->bus_upgrades++;
+            invalidateOthers(sys, c, addr);
+        }
+    } else {
+        cache->miss_count++;
+        written = blockmapFind(&core->lost, block);
+        if (written) {
+            line_stats_t* line = lineStats(sys, block);
+            core->coherence_misses++;
+            line->coherence_misses++;
+            if (!(*written & mask)) {
+                core->false_sharing++;
+                line->false_sharing++;
+            }
+            blockmapRemove(&core->lost, block);
+        }
+
+        if (write) {
+            sys->bus_read_exclusives++;
+            invalidateOthers(sys, c, addr);
+        } else {
+            sys->bus_reads++;
+            for (int o = 0; o < sys->ncores; o++) {
+                core_t* other = &sys->cores[o];
+                int other_way;
+
+                if (o == c ||
+                    (other_way = lookupCache(&other->cache, addr)) < 0)
+                    continue;
+                flushLine(sys, other, addr, other_way);
+                *lineWord(&other->cache, other->shared, addr, other_way) |=
+                    1ULL << (other_way % 64);
+                others = 1;
+            }
+        }
+
+        cache->bytes_from_next += cache->B;
+        switch (fillCache(cache, addr, NULL)) {
+        case FILL_EVICT_DIRTY:
+            cache->writeback_count++;
+            cache->bytes_to_next += cache->B;
+            /* fall through */
+        case FILL_EVICT:
+            cache->eviction_count++;
+        }
+        /* a loaded line is S if another core holds it, else E */
+        way = lookupCache(cache, addr);
+        if (others)
+            *lineWord(cache, core->shared, addr, way) |= 1ULL << (way % 64);
+        else
+            *lineWord(cache, core->shared, addr, way) &= ~(1ULL << (way % 64));
+    }
+
+    /* a store leaves the line M */
+    if (write) {
+        *lineWord(cache, core->shared, addr, way) &= ~(1ULL << (way % 64));
+        *lineWord(cache, cache->dirty, addr, way) |= 1ULL << (way % 64);
+        recordWrite(sys, c, addr, mask);
+    }
+}
+
+/*
+ * nextRecord - The next record of core c, or NULL at its end
+ */
+static const trace_access_t* nextRecord(core_t* core)
+{
+    if (core->pos == core->len) {
+        if (!core->tr)
+            return NULL;
+        core->len = traceRead(core->tr, core->batch, TRACE_BATCH);
+        core->pos = 0;
+        if (core->len == 0) {
+            traceClose(core->tr);
+            core->tr = NULL;
+            return NULL;
+        }
+    }
+    return &core->batch[core->pos];
+}
+
+/*
+ * freeCoherence - free allocated memory
+ */
+static void freeCoherence(coherence_t* sys)
+{
+    for (int c = 0; c < sys->ncores; c++) {
+        core_t* core = &sys->cores[c];
+        if (core->tr)
+            traceClose(core->tr);
+        freeCache(&core->cache);
+        freeBlockmap(&core->lost);
+        free(core->shared);
+        free(core->batch);
+    }
+    freeBlockmap(&sys->line_index);
+    free(sys->lines);
+    free(sys->cores);
+}
+
+/*
+ * compareLines - Order lines by false sharing, then coherence misses,
+ *     then invalidations, all decreasing
+ */
+static int compareLines(const void* a, const void* b)
+{
+    const line_stats_t* la = a;
+    const line_stats_t* lb = b;
+
+    if (la->false_sharing != lb->false_sharing)
+        return la->false_sharing < lb->false_sharing ? 1 : -1;
+    if (la->coherence_misses != lb->coherence_misses)
+        return la->coherence_misses < lb->coherence_misses ? 1 : -1;
+    if (la->invalidations != lb->invalidations)
+        return la->invalidations < lb->invalidations ? 1 : -1;
+    return la->block < lb->block ? -1 : la->block > lb->block;
+}
+
+/*
+ * printCoherence - Print per-core, bus and per-line results
+ */
+static void printCoherence(coherence_t* sys, int verbose)
+{
+    size_t nshown;
+
+    for (int c = 0; c < sys->ncores; c++) {
+        const core_t* core = &sys->cores[c];
+        printf("core %d hits:%llu misses:%llu evictions:%llu writebacks:%llu "
+               "invalidations:%llu coherence_misses:%llu false_sharing:%llu\n",
+               c, core->cache.hit_count, core->cache.miss_count,
+               core->cache.eviction_count, core->cache.writeback_count,
+               core->invalidations, core->coherence_misses,
+               core->false_sharing);
+    }
+    printf("bus reads:%llu read_exclusives:%llu upgrades:%llu flushes:%llu\n",
+           sys->bus_reads, sys->bus_read_exclusives, sys->bus_upgrades,
+           sys->flushes);
+
+    qsort(sys->lines, sys->nlines, sizeof(line_stats_t), compareLines);
+    nshown = sys->nlines;
+    if (!verbose && nshown > COHERENCE_TOP_LINES)
+        nshown = COHERENCE_TOP_LINES;
+    for (size_t i = 0; i < nshown; i++) {
+        const line_stats_t* line = &sys->lines[i];
+        printf("line %llx invalidations:%llu coherence_misses:%llu "
+               "false_sharing:%llu\n", line->block << sys->b,
+               line->invalidations, line->coherence_misses,
+               line->false_sharing);
+    }
+}
+
+/*
+ * runCoherence - Replay one trace per core through MESI caches
+ */
+int runCoherence(char** trace_fns, int ncores, int s, int E, int b,
+                 const cache_policy_t* policy, int by_timestamp, int verbose)
+{
+    coherence_t sys;
+    int c, live;
+
+    memset(&sys, 0, sizeof(coherence_t));
+    sys.b = b;
+    sys.granule = b > 6 ? 1 << (b - 6) : 1;
+    sys.cores = calloc(ncores, sizeof(core_t));
+    sys.ncores = ncores;
+    if (initBlockmap(&sys.line_index) < 0)
+        goto fail;
+    for (c = 0; c < ncores; c++) {
+        core_t* core = &sys.cores[c];
+
+        if (initCache(&core->cache, s, E, b, policy) < 0) {
+            fprintf(stderr, "Cannot simulate s=%d E=%d b=%d\n", s, E, b);
+            goto fail;
+        }
+        core->shared = calloc((size_t)core->cache.S * core->cache.valid_words,
+                              sizeof(unsigned long long));
+        core->batch = malloc(TRACE_BATCH * sizeof(trace_access_t));
+        if (initBlockmap(&core->lost) < 0 || !core->shared || !core->batch)
+            goto fail;
+        core->tr = traceOpen(trace_fns[c]);
+        if (!core->tr)
+            goto fail;
+    }
+
+    for (live = ncores, c = 0; live > 0; ) {
+        const trace_access_t* access;
+        core_t* core;
+
+        if (by_timestamp) {
+            /* the core furthest behind goes next, lowest number first */
+            int next = -1;
+            for (int o = 0; o < ncores; o++)
+                if (nextRecord(&sys.cores[o]) &&
+                    (next < 0 || sys.cores[o].clock < sys.cores[next].clock))
+                    next = o;
+            if (next < 0)
+                break;
+            c = next;
+        }
+        core = &sys.cores[c];
+        access = nextRecord(core);
+        if (!access) {
+            /* round-robin: count the cores that ran dry in this turn */
+            live = 0;
+            for (int o = 0; o < ncores; o++)
+                live += nextRecord(&sys.cores[o]) != NULL;
+            c = (c + 1) % ncores;
+            continue;
+        }
+        core->pos++;
+
+        if (access->op == 'I') {
+            core->seen_instruction = 1;
+            core->clock++;
+        } else {
+            if (!core->seen_instruction)
+                core->clock++;
+            /* a modify is a load followed by a store */
+            if (access->op != 'S')
+                coherentAccess(&sys, c, access->addr, access->size, 0);
+            if (access->op != 'L')
+                coherentAccess(&sys, c, access->addr, access->size, 1);
+        }
+        if (!by_timestamp)
+            c = (c + 1) % ncores;
+    }
+
+    printCoherence(&sys, verbose);
+    freeCoherence(&sys);
+    return 0;
+
+fail:
+    freeCoherence(&sys);
+    return -1;
+}
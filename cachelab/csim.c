@@ -1,7 +1,8 @@
 /*
  * csim.c - A cache simulator that can replay traces from Valgrind
  *     and output statistics such as number of hits, misses, and
- *     evictions.  The replacement policy is MRU.
+ *     evictions.  The replacement policy is MRU unless another one
+ *     is chosen with -p.  The cache model itself lives in cache.c.
  *
  * modified by Brady Olson
  * December 10, 2016
@@ -20,169 +21,134 @@
 #include <string.h>
 #include <errno.h>
 #include "cachelab.h"
+#include "csim.h"
+#include "missclass.h"
+#include "prefetch.h"
+#include "tlb.h"
+#include "pcstats.h"
+#include "victim.h"
+#include "window.h"
+#include "timing.h"
 
 //#define DEBUG_ON 
 #define ADDRESS_LENGTH 64
-
-/* Type: Memory address */
-typedef unsigned long long int mem_addr_t;
-
-/* Type: Cache line
-   MRU is a counter used to implement MRU replacement policy  */
-typedef struct cache_line {
-    char valid;
-    mem_addr_t tag;
-    unsigned long long int mru;
-} cache_line_t;
-
-typedef cache_line_t* cache_set_t;
-typedef cache_set_t* cache_t;
+#define MAX_CORES 64
 
 /* Globals set by command line args */
 int verbosity = 0; /* print trace if set */
 int s = 0; /* set index bits */
 int b = 0; /* block offset bits */
+int sector_bits = -1; /* sector offset bits, whole blocks if -1 */
 int E = 0; /* associativity */
 char* trace_file = NULL;
-
-/* Derived from command line args */
-int S; /* number of sets */
-int B; /* block size (bytes) */
-
-/* Counters used to record cache statistics */
-int miss_count = 0;
-int hit_count = 0;
-int eviction_count = 0;
-unsigned long long int mru_counter = 1;
+char* core_traces[MAX_CORES]; /* one trace per core if -t is repeated */
+int num_cores = 0;
+int interleave_by_timestamp = 0; /* interleave core traces by time */
+const cache_policy_t* policy = NULL; /* replacement policy, MRU if NULL */
+cache_index_t indexing = INDEX_MODULO; /* set index function */
+int write_back = 1; /* write-back (1) or write-through (0) */
+int write_allocate = 1; /* allocate lines on store misses if set */
+int print_traffic = 0; /* print writebacks and traffic if set */
+int classify_misses = 0; /* split misses into the 3Cs if set */
+char* prefetch_spec = NULL; /* hardware prefetcher, none if NULL */
+char* victim_spec = NULL; /* victim or miss cache, none if NULL */
+char* timing_spec = NULL; /* latencies, MSHRs and bandwidth, none if NULL */
+char* tlb_spec = NULL; /* TLB levels and page size, none if NULL */
+char* icache_spec = NULL; /* instruction cache s:E:b, none if NULL */
+int attribute_pcs = 0; /* print data misses per instruction if set */
+unsigned long long window_size = 0; /* data records per window if set */
+char* window_file = "-"; /* where the windows go, - for stdout */
+char* sweep_spec = NULL; /* cache geometries of a sweep */
+int num_threads = 0; /* sweep worker threads, 0 for one per CPU */
+char* hierarchy_spec = NULL; /* cache hierarchy, inline or a file */
+int stack_max_E = 0; /* largest associativity of a stack distance run */
+double sample_rate = 0; /* sample stack distances at this rate if set */
+int sample_blocks = 65536; /* most blocks tracked while sampling */
+double set_sample_rate = 0; /* simulate this fraction of the sets if set */
+int time_chunks = 0; /* simulate this many chunks in parallel if set */
+long long warmup_records = -1; /* warm-up per chunk, sized to the cache if -1 */
+char options_given[128]; /* set for every option letter given */
 
 /* The cache we are simulating */
-cache_t cache;  
-mem_addr_t set_index_mask;
-
-/* 
- * initCache - Allocate memory, write 0's for valid and tag and MRU
- * also computes the set_index_mask
- */
-void initCache() {
-    set_index_mask = S - 1;
+cache_t cache;
+miss_class_t miss_class;
+prefetcher_t prefetcher;
+victim_cache_t victim_cache;
+tlb_t tlb;
+cache_t icache;
+pc_table_t pc_table;
+window_writer_t windows;
+timing_t timing;
+
+#define TOP_PCS 20
 
-    /* allocate space for cache */
-    cache = malloc(S * sizeof(cache_t*));
-    for (int currentSet = 0; currentSet < S; currentSet++) {
-        /* allocate space for each cache line */
-        cache[currentSet] = malloc(E * sizeof(cache_line_t));
-        for (int currentLine = 0; currentLine < E; currentLine++) {
-            /* initialize all valid bits, tags, and MRU count to 0 */
-            cache[currentSet][currentLine].valid = 0;
-            cache[currentSet][currentLine].tag = 0;
-            cache[currentSet][currentLine].mru = 0;
-        }   
-    }   
-}
-
-
-/* 
- * freeCache - free allocated memory
+/*
+ * replayRecords - replays n decoded records against the cache and
+ *     whatever is attached to it
  */
-void freeCache()
+void replayRecords(const trace_access_t* batch, size_t n)
 {
-    int i;
-    for (i=0; i<S; i++){
-        free(cache[i]);
+    /*    ACCESS THE CACHE, i.e. CALL accessData */
+    if (!prefetch_spec && !attribute_pcs && !timing_spec) {
+        accessBatch(&cache, batch, n);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            unsigned long long misses = cache.miss_count;
+            unsigned long long evictions = cache.eviction_count;
+            unsigned long long bytes_out = cache.bytes_to_next;
+
+            if (prefetch_spec)
+                prefetchAccess(&prefetcher, &batch[i]);
+            else
+                accessTrace(&cache, &batch[i]);
+            if (attribute_pcs)
+                pcCount(&pc_table, &batch[i], cache.miss_count - misses,
+                        cache.eviction_count - evictions);
+            if (timing_spec)
+                timingRecord(&timing, &batch[i], cache.miss_count - misses,
+                             cache.bytes_to_next - bytes_out);
+        }
     }
-    free(cache);
-}
-
-
-/* 
- * accessData - Access data at memory address addr.
- *   If it is already in cache, increast hit_count
- *   If it is not in cache, bring it in cache, increase miss count.
- *   Also increase eviction_count if a line is evicted.
- */
-void accessData(mem_addr_t addr) {
-	/* initialize largest MRU value counter*/
-    long long largestMRUval = 0;
-    /* initialize largest MRU index */
-    long largestMRUindex;
-    /* get set index and bitwise-and with mask */
-    long long currentSet = (addr >> b) & set_index_mask;
-    /* get cache tag */
-    long currentTag = (addr >> (s + b));
-
-	for(int currentLine = 0; currentLine < E; currentLine++) {
-		/* if current line matches with tag and is valid,
-			update hitcounter & mru.
-			then return since no miss calculatino required. */
-		if (cache[currentSet][currentLine].tag == currentTag && 
-			cache[currentSet][currentLine].valid == 1) {
-			hit_count++;
-			cache[currentSet][currentLine].mru = mru_counter++;
-			return;
-		}
-	}
-	/* postcondition of loop:
-		function did not return, so must be cache miss. */
-	miss_count++;
-
-	for(int currentLine = 0; currentLine < E; currentLine++) {
-		/* if curernt line is empty,
-			load block and update valid & mru.
-			then return since no eviction required. */
-		if(cache[currentSet][currentLine].mru == 0) {
-			cache[currentSet][currentLine].tag = currentTag;
-			cache[currentSet][currentLine].valid = 1;
-			cache[currentSet][currentLine].mru = mru_counter++;
-			return;
-		}
-		/* if current line has highest MRUval thus far,
-			update largest MRU value counter and index. */
-		if(cache[currentSet][currentLine].mru > largestMRUval) {
-			largestMRUval = cache[currentSet][currentLine].mru;
-			largestMRUindex = currentLine;
-		}
-	}
-	/* postcondition of loop:
-		function did not return so largestMRUindex holds
-		the index of line with highest MRU value. */
-	eviction_count++;
-	/* line eviction based on above loop result. */
-	cache[currentSet][largestMRUindex].tag = currentTag;
-	cache[currentSet][largestMRUindex].valid = 1;
-	cache[currentSet][largestMRUindex].mru = mru_counter++;
+    if (icache_spec)
+        for (size_t i = 0; i < n; i++)
+            if (batch[i].op == 'I')
+                accessData(&icache, batch[i].addr);
+    if (tlb_spec)
+        for (size_t i = 0; i < n; i++)
+            tlbAccessTrace(&tlb, &batch[i]);
 }
 
 /*
  * replayTrace - replays the given trace file against the cache 
+ *     The file may be a lackey text trace or a binary trace written
+ *     by traceconv, either one gzipped, or "-" for stdin.
  */
 void replayTrace(char* trace_fn)
 {
-    char buf[1000];
-    mem_addr_t addr=0;
-    unsigned int len=0;
-    FILE* trace_fp = fopen(trace_fn, "r");
+    trace_access_t batch[TRACE_BATCH];
+    size_t n;
+    trace_reader_t* tr = traceOpen(trace_fn);
 
-    if(!trace_fp){
-        fprintf(stderr, "%s: %s\n", trace_fn, strerror(errno));
+    if(!tr){
         exit(1);
     }
+    /* parse and decompress on another CPU; without it we just decode here */
+    traceStartReadAhead(tr);
 
-    while(fgets(buf, 1000, trace_fp) != NULL) {
-        /* buf[Y] gives the Yth byte in the trace line */
-
-        /* Read address and length from the trace using sscanf 
-         */
-        if (buf[1] == 'M' || buf[1] == 'L' || buf[1] == 'S') {
-            sscanf(buf + 3, "%llx, %u", &addr, &len);
-            accessData(addr);
+    while((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        if (!window_size) {
+            replayRecords(batch, n);
+            continue;
         }
-         /*    ACCESS THE CACHE, i.e. CALL accessData */
-        if (buf[1] == 'M') {
-            accessData(addr);
+        /* cut the batch where windows end and snapshot the counters */
+        for (size_t done = 0, k; done < n; done += k) {
+            k = windowSplit(&windows, batch + done, n - done);
+            replayRecords(batch + done, k);
+            windowEnd(&windows, &cache);
         }
     }
 
-    fclose(trace_fp);
+    traceClose(tr);
 }
 
 /*
@@ -190,20 +156,124 @@ void replayTrace(char* trace_fn)
  */
 void printUsage(char* argv[])
 {
-    printf("Usage: %s [-hv] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("Usage: %s [-hvca] [-p <policy>] [-x <index>] [-k <num>] [-I <s:E:b>] [-F <spec>] [-V <spec>] [-T <spec>] [-M <spec>] [-N <num> [-o <file>]] [-W wb|wt] [-A wa|nwa] -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("       %s -G <list> [-j <num>] [-p <policy>] -t <file>\n", argv[0]);
+    printf("       %s [-v] [-i rr|ts] -s <num> -E <num> -b <num> -t <file> -t <file> ...\n", argv[0]);
+    printf("       %s -P <num> [-w <num>] [-j <num>] -p lru -s <num> -E <num> -b <num> -t <file>\n", argv[0]);
+    printf("       %s -H <spec|file> [-M <spec>] [-p <policy>] -t <file>\n", argv[0]);
+    printf("       %s -D <num> [-R <rate> [-L <num>]] -s <num> -b <num> -t <file>\n", argv[0]);
     printf("Options:\n");
     printf("  -h         Print this help message.\n");
     printf("  -v         Optional verbose flag.\n");
     printf("  -s <num>   Number of set index bits.\n");
     printf("  -E <num>   Number of lines per set.\n");
     printf("  -b <num>   Number of block offset bits.\n");
-    printf("  -t <file>  Trace file.\n");
+    printf("  -k <num>   Number of sector offset bits: blocks are filled\n");
+    printf("             and written back in sectors of 2^k bytes under\n");
+    printf("             one tag (k from b-6 to b).  Prints tag and\n");
+    printf("             sector misses and the bytes moved.\n");
+    printf("  -t <file>  Trace file (lackey text or traceconv binary, either\n");
+    printf("             possibly gzipped), or - for stdin.  Given more\n");
+    printf("             than once, each trace runs on its own core with\n");
+    printf("             a private cache kept coherent by MESI.\n");
+    printf("  -i <mode>  Interleave core traces round-robin (rr, default)\n");
+    printf("             or by instruction count (ts).\n");
+    printf("  -p <name>  Replacement policy: mru (default), lru, fifo,\n");
+    printf("             random, plru (E a power of two) or srrip.\n");
+    printf("  -x <name>  Set index function: modulo (default), xor (XOR of\n");
+    printf("             the s-bit chunks of the block number), prime (block\n");
+    printf("             number modulo the largest prime below 2^s) or skew\n");
+    printf("             (a different hash per way, replaced LRU).\n");
+    printf("  -S <rate>  Simulate only a hashed sample of the sets and\n");
+    printf("             print scaled estimates with 95%% intervals.\n");
+    printf("  -P <num>   Cut the trace into num chunks simulated in parallel\n");
+    printf("             and print merged counts with error bounds.  The\n");
+    printf("             trace must be a file that is not gzipped, and\n");
+    printf("             the policy lru.\n");
+    printf("  -w <num>   With -P, records replayed before each chunk to warm\n");
+    printf("             its cache (default: four per cache line).\n");
+    printf("  -F <spec>  Model a hardware prefetcher: next[:degree],\n");
+    printf("             stride[:entries[:degree]] or stream[:buffers[:depth]],\n");
+    printf("             optionally followed by ,latency=<accesses>.\n");
+    printf("  -I <s:E:b> Feed the instruction fetches to an instruction\n");
+    printf("             cache of this geometry.\n");
+    printf("  -a         Print the data misses and evictions of the %d\n", TOP_PCS);
+    printf("             instructions with the most misses (all with -v).\n");
+    printf("  -V <spec>  Put a fully-associative victim cache of the given\n");
+    printf("             entries behind the cache, or a miss cache with\n");
+    printf("             miss:<entries>.\n");
+    printf("  -T <spec>  Model a TLB next to the cache, e.g. \"l1=64:4\n");
+    printf("             l2=1536:12 page=4k\" (entries:ways per level, page\n");
+    printf("             4k, 2m or 1g), and count page walk references.\n");
+    printf("  -M <spec>  Estimate cycles, AMAT and memory-level parallelism\n");
+    printf("             from per-level latencies, MSHRs and the bandwidth\n");
+    printf("             to the next level, e.g. \"lat=4:200,mshrs=8,bw=16\"\n");
+    printf("             (one latency per cache level, then memory).\n");
+    printf("  -N <num>   Write hits, misses and evictions of every window of\n");
+    printf("             num data accesses (a modify makes two) as CSV, or\n");
+    printf("             binary with -o *.bin.\n");
+    printf("  -o <file>  Where -N writes to (default: - for stdout).\n");
+    printf("  -c         Split misses into compulsory, capacity and\n");
+    printf("             conflict misses, per set and in total.\n");
+    printf("  -W <wb|wt> Write-back (default) or write-through stores.\n");
+    printf("  -A <wa|nwa> Write-allocate (default) or no-write-allocate.\n");
+    printf("             Either option also prints writebacks and the\n");
+    printf("             bytes moved from and to the next level.\n");
+    printf("  -G <list>  Sweep the cache geometries in list, given as\n");
+    printf("             s:E:b triples separated by ','.  Each field is a\n");
+    printf("             number, a range lo-hi, or several joined by '/'.\n");
+    printf("  -j <num>   Worker threads for -G or -P (default: one per\n");
+    printf("             CPU).\n");
+    printf("  -H <spec>  Simulate a cache hierarchy given inline or in a file,\n");
+    printf("             e.g. \"l1i=6:8:6 l1d=6:8:6 l2=9:8:6 llc=12:16:6\n");
+    printf("             inclusion=inclusive\" (or exclusive, nine).\n");
+    printf("  -D <num>   Print LRU stack distances and the results of\n");
+    printf("             every E up to num for the given s and b.\n");
+    printf("  -R <rate>  With -D, estimate miss ratios from a hashed\n");
+    printf("             sample of the blocks (SHARDS) in bounded memory.\n");
+    printf("  -L <num>   With -R, track at most num blocks (default 65536).\n");
     printf("\nExamples:\n");
     printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
     printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -p lru -s 4 -E 4 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  valgrind --tool=lackey --trace-mem=yes ls 2>&1 | %s -s 6 -E 8 -b 6 -t -\n", argv[0]);
+    printf("  linux>  %s -k 4 -s 4 -E 2 -b 6 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -x skew -s 5 -E 2 -b 5 -t traces/trans.trace\n", argv[0]);
+    printf("  linux>  %s -S 0.125 -s 10 -E 8 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -P 8 -w 100000 -p lru -s 10 -E 8 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -F stride:64:2 -s 4 -E 2 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -T \"l1=64:4 l2=1536:12\" -s 6 -E 8 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -a -I 6:8:6 -s 6 -E 8 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -V 8 -s 5 -E 1 -b 5 -t traces/trans.trace\n", argv[0]);
+    printf("  linux>  %s -M lat=4:200,mshrs=4,bw=8 -s 8 -E 4 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -H \"l1=6:8:6 l2=10:8:6\" -M lat=4:14:200 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -N 100000 -o phases.csv -s 8 -E 4 -b 6 -t big.trace\n", argv[0]);
+    printf("  linux>  %s -c -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv[0]);
+    printf("  linux>  %s -W wt -A nwa -s 4 -E 4 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -G 2-6:1/2/4:4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -s 6 -E 8 -b 6 -t core0.trace -t core1.trace\n", argv[0]);
+    printf("  linux>  %s -H \"l1=5:2:5 l2=8:8:5\" -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -D 16 -s 4 -b 4 -t traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -D 64 -R 0.01 -s 6 -b 6 -t big.trace\n", argv[0]);
     exit(0);
 }
 
+/*
+ * checkOptions - Exit with the usage if an option was given that mode
+ *     does not support; allowed lists the letters of those it does.
+ *     -v is accepted everywhere.
+ */
+void checkOptions(char* argv[], const char* mode, const char* allowed)
+{
+    for (int c = 1; c < 128; c++) {
+        if (options_given[c] && c != 'v' && !strchr(allowed, c)) {
+            printf("%s: -%c cannot be combined with %s\n", argv[0], c, mode);
+            printUsage(argv);
+            exit(1);
+        }
+    }
+}
+
 /*
  * main - Main routine 
  */
@@ -211,7 +281,8 @@ int main(int argc, char* argv[])
 {
     char c;
 
-    while( (c=getopt(argc,argv,"s:E:b:t:vh")) != -1){
+    while( (c=getopt(argc,argv,"s:E:b:k:t:i:p:W:A:F:V:T:M:G:j:H:D:R:L:S:P:w:I:N:o:x:acvh")) != -1){
+        options_given[(unsigned char)c & 127] = 1;
         switch(c){
         case 's':
             s = atoi(optarg);
@@ -224,6 +295,110 @@ int main(int argc, char* argv[])
             break;
         case 't':
             trace_file = optarg;
+            if (num_cores == MAX_CORES) {
+                printf("%s: At most %d traces\n", argv[0], MAX_CORES);
+                exit(1);
+            }
+            core_traces[num_cores++] = optarg;
+            break;
+        case 'i':
+            if (strcmp(optarg, "rr") != 0 && strcmp(optarg, "ts") != 0) {
+                printf("%s: Unknown interleaving %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            interleave_by_timestamp = strcmp(optarg, "ts") == 0;
+            break;
+        case 'p':
+            policy = findPolicy(optarg);
+            if (!policy) {
+                printf("%s: Unknown replacement policy %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            break;
+        case 'k':
+            sector_bits = atoi(optarg);
+            break;
+        case 'x':
+            if (findIndexing(optarg) < 0) {
+                printf("%s: Unknown index function %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            indexing = findIndexing(optarg);
+            break;
+        case 'W':
+            if (strcmp(optarg, "wb") != 0 && strcmp(optarg, "wt") != 0) {
+                printf("%s: Unknown write policy %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            write_back = strcmp(optarg, "wb") == 0;
+            print_traffic = 1;
+            break;
+        case 'A':
+            if (strcmp(optarg, "wa") != 0 && strcmp(optarg, "nwa") != 0) {
+                printf("%s: Unknown allocation policy %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            write_allocate = strcmp(optarg, "wa") == 0;
+            print_traffic = 1;
+            break;
+        case 'G':
+            sweep_spec = optarg;
+            break;
+        case 'j':
+            num_threads = atoi(optarg);
+            break;
+        case 'H':
+            hierarchy_spec = optarg;
+            break;
+        case 'D':
+            stack_max_E = atoi(optarg);
+            break;
+        case 'R':
+            sample_rate = atof(optarg);
+            break;
+        case 'L':
+            sample_blocks = atoi(optarg);
+            break;
+        case 'S':
+            set_sample_rate = atof(optarg);
+            break;
+        case 'P':
+            time_chunks = atoi(optarg);
+            break;
+        case 'w':
+            warmup_records = atoll(optarg);
+            break;
+        case 'F':
+            prefetch_spec = optarg;
+            break;
+        case 'V':
+            victim_spec = optarg;
+            break;
+        case 'M':
+            timing_spec = optarg;
+            break;
+        case 'T':
+            tlb_spec = optarg;
+            break;
+        case 'I':
+            icache_spec = optarg;
+            break;
+        case 'N':
+            window_size = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            window_file = optarg;
+            break;
+        case 'a':
+            attribute_pcs = 1;
+            break;
+        case 'c':
+            classify_misses = 1;
             break;
         case 'v':
             verbosity = 1;
@@ -237,6 +412,49 @@ int main(int argc, char* argv[])
         }   
     }   
 
+    /* A sweep simulates its own caches and prints one row for each */
+    if (sweep_spec != NULL) {
+        if (trace_file == NULL) {
+            printf("%s: Missing required command line argument\n", argv[0]);
+            printUsage(argv);
+            exit(1);
+        }
+        checkOptions(argv, "-G", "Gjtp");
+        if (runSweep(trace_file, sweep_spec, num_threads, policy) < 0)
+            exit(1);
+        return 0;
+    }
+
+    /* A hierarchy brings its own geometries */
+    if (hierarchy_spec != NULL) {
+        if (trace_file == NULL) {
+            printf("%s: Missing required command line argument\n", argv[0]);
+            printUsage(argv);
+            exit(1);
+        }
+        checkOptions(argv, "-H", "HtpM");
+        if (runHierarchy(trace_file, hierarchy_spec, policy, timing_spec) < 0)
+            exit(1);
+        return 0;
+    }
+
+    /* A stack distance run covers every E at once; s may be 0 here */
+    if (stack_max_E != 0) {
+        if (b == 0 || trace_file == NULL) {
+            printf("%s: Missing required command line argument\n", argv[0]);
+            printUsage(argv);
+            exit(1);
+        }
+        if (sample_rate != 0) {
+            if (runShards(trace_file, s, b, stack_max_E, sample_rate,
+                          sample_blocks) < 0)
+                exit(1);
+        } else if (runStackDist(trace_file, s, b, stack_max_E) < 0) {
+            exit(1);
+        }
+        return 0;
+    }
+
     /* Make sure that all required command line args were specified */
     if (s == 0 || E == 0 || b == 0 || trace_file == NULL) {
         printf("%s: Missing required command line argument\n", argv[0]);
@@ -244,27 +462,134 @@ int main(int argc, char* argv[])
         exit(1);
     }   
 
-    /* Compute S, E and B from command line args */
-    S = pow(2,s);
-    B = pow(2,b);
+    /* A sampled run simulates a fraction of the sets */
+    if (set_sample_rate != 0) {
+        checkOptions(argv, "-S", "SsEbtp");
+        if (runSetSample(trace_file, s, E, b, policy, set_sample_rate) < 0)
+            exit(1);
+        return 0;
+    }
+
+    /* A time-sharded run simulates chunks of the trace in parallel */
+    if (time_chunks != 0) {
+        checkOptions(argv, "-P", "PwjpsEbt");
+        if (runTimeShards(trace_file, s, E, b, policy, time_chunks,
+                          warmup_records, num_threads) < 0)
+            exit(1);
+        return 0;
+    }
 
+    /* Several traces run on a coherent multicore */
+    if (num_cores > 1) {
+        checkOptions(argv, "several -t", "tsEbpi");
+        if (runCoherence(core_traces, num_cores, s, E, b, policy,
+                         interleave_by_timestamp, verbosity) < 0)
+            exit(1);
+        return 0;
+    }
+
+    /* Prefetchers and victim caches move whole blocks */
+    if (sector_bits >= 0 && (prefetch_spec || victim_spec)) {
+        printf("%s: -k cannot be combined with -F or -V\n", argv[0]);
+        printUsage(argv);
+        exit(1);
+    }
 
     /* Initialize cache */
-    initCache();
+    if (initCacheSectored(&cache, s, E, b, policy, indexing,
+                          sector_bits < 0 ? b : sector_bits) < 0) {
+        printf("%s: Cannot simulate a cache with s=%d E=%d b=%d using %s\n",
+               argv[0], s, E, b, policy ? policy->name : "mru");
+        exit(1);
+    }
+    cache.write_back = write_back;
+    cache.write_allocate = write_allocate;
+    if (classify_misses && initMissClass(&miss_class, &cache) < 0) {
+        printf("%s: Out of memory\n", argv[0]);
+        exit(1);
+    }
+    if (prefetch_spec && initPrefetcher(&prefetcher, &cache, prefetch_spec) < 0)
+        exit(1);
+    if (victim_spec && initVictimCache(&victim_cache, &cache, victim_spec) < 0)
+        exit(1);
+    if (tlb_spec && initTlb(&tlb, tlb_spec) < 0)
+        exit(1);
+    if (icache_spec) {
+        int is, iE, ib, used = 0;
+
+        if (sscanf(icache_spec, "%d:%d:%d%n", &is, &iE, &ib, &used) != 3 ||
+            icache_spec[used] != '\0' ||
+            initCache(&icache, is, iE, ib, policy) < 0) {
+            printf("%s: Cannot simulate an instruction cache %s\n",
+                   argv[0], icache_spec);
+            exit(1);
+        }
+    }
+    if (timing_spec &&
+        initTiming(&timing, timing_spec, 1, cache.sector_bits) < 0)
+        exit(1);
+    if (window_size && initWindows(&windows, window_file, window_size) < 0)
+        exit(1);
+    if (attribute_pcs && initPcTable(&pc_table) < 0) {
+        printf("%s: Out of memory\n", argv[0]);
+        exit(1);
+    }
 
 #ifdef DEBUG_ON
-    printf("DEBUG: S:%u E:%u B:%u trace:%s\n", S, E, B, trace_file);
-    printf("DEBUG: set_index_mask: %llu\n", set_index_mask);
+    printf("DEBUG: S:%u E:%u B:%u trace:%s\n", cache.S, E, cache.B, trace_file);
+    printf("DEBUG: set_index_mask: %llu\n", cache.set_index_mask);
 #endif
     
     /* Read the trace and access the cache */
     replayTrace(trace_file);
+    if (window_size && closeWindows(&windows, &cache) < 0)
+        exit(1);
 
     /* Free allocated memory */
-    freeCache();
+    freeCache(&cache);
 
     /* Output the hit and miss statistics for the autograder */
-    printSummary(hit_count, miss_count, eviction_count);
+    printSummary((int)cache.hit_count, (int)cache.miss_count,
+                 (int)cache.eviction_count);
+    if (print_traffic)
+        printf("writebacks:%llu bytes_from_next:%llu bytes_to_next:%llu\n",
+               cache.writeback_count, cache.bytes_from_next,
+               cache.bytes_to_next);
+    if (sector_bits >= 0)
+        printf("tags:%d sectors:%d tag_misses:%llu sector_misses:%llu "
+               "fill_bytes:%llu writeback_bytes:%llu\n", cache.S * E,
+               cache.sectors, cache.miss_count - cache.sector_miss_count,
+               cache.sector_miss_count, cache.bytes_from_next,
+               cache.bytes_to_next);
+    if (timing_spec) {
+        printTiming(&timing, stdout);
+        freeTiming(&timing);
+    }
+    if (prefetch_spec) {
+        printPrefetcher(&prefetcher, stdout);
+        freePrefetcher(&prefetcher);
+    }
+    if (victim_spec) {
+        printVictimCache(&victim_cache, stdout);
+        freeVictimCache(&victim_cache, &cache);
+    }
+    if (tlb_spec) {
+        printTlb(&tlb, stdout);
+        freeTlb(&tlb);
+    }
+    if (icache_spec) {
+        printf("icache hits:%llu misses:%llu evictions:%llu\n",
+               icache.hit_count, icache.miss_count, icache.eviction_count);
+        freeCache(&icache);
+    }
+    if (classify_misses) {
+        printMissClass(&miss_class, stdout);
+        freeMissClass(&miss_class);
+    }
+    if (attribute_pcs) {
+        printPcTable(&pc_table, verbosity ? 0 : TOP_PCS, stdout);
+        freePcTable(&pc_table);
+    }
     return 0;
 }
 
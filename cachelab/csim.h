@@ -0,0 +1,84 @@
+/*
+ * csim.h - Simulation modes csim offers besides replaying a trace
+ *     against a single cache
+ */
+#ifndef CSIM_H
+#define CSIM_H
+
+#include "cache.h"
+
+/*
+ * runSweep - Simulate every cache geometry described by spec against
+ *     one pass over the trace, spreading the caches across nthreads
+ *     worker threads (0 picks one per online CPU).  All caches use the
+ *     given replacement policy.  Prints one result row per geometry.
+ *     Returns 0 on success.
+ */
+int runSweep(char* trace_fn, char* spec, int nthreads,
+             const cache_policy_t* policy);
+
+/*
+ * runStackDist - Compute LRU stack distances for 2^s sets of 2^b byte
+ *     blocks in one pass and print their histogram together with the
+ *     hits, misses and evictions of every associativity up to max_E.
+ *     Returns 0 on success.
+ */
+int runStackDist(char* trace_fn, int s, int b, int max_E);
+
+/*
+ * runShards - Like runStackDist, but estimate the miss ratio of every
+ *     associativity up to max_E from a hashed sample of the blocks,
+ *     starting at the given rate and tracking at most max_blocks
+ *     blocks.  Prints error estimates with the curve.  Returns 0 on
+ *     success.
+ */
+int runShards(char* trace_fn, int s, int b, int max_E, double rate,
+              int max_blocks);
+
+/*
+ * runHierarchy - Replay the trace through the cache hierarchy
+ *     described by spec (see initHierarchy), or by the file spec
+ *     names, and print the counters of every level.  With a
+ *     timing_spec (see initTiming) the data accesses are also timed.
+ *     Returns 0 on success.
+ */
+int runHierarchy(char* trace_fn, char* spec, const cache_policy_t* policy,
+                 const char* timing_spec);
+
+/*
+ * runCoherence - Replay trace i on core i of an ncores-way multicore
+ *     whose private caches of 2^s sets, E lines and 2^b byte blocks
+ *     are kept coherent by snoopy MESI.  The traces are interleaved
+ *     round-robin or, if by_timestamp is set, by instruction count.
+ *     Prints per-core and bus counters and the lines with the most
+ *     coherence traffic (all of them if verbose).  Returns 0 on
+ *     success.
+ */
+int runCoherence(char** trace_fns, int ncores, int s, int E, int b,
+                 const cache_policy_t* policy, int by_timestamp, int verbose);
+
+/*
+ * runSetSample - Simulate only the sets of a 2^s set, E way, 2^b byte
+ *     block cache whose hashed index falls in a sample of the given
+ *     rate, and print hits, misses and evictions scaled to the whole
+ *     trace with 95% confidence intervals.  Returns 0 on success.
+ */
+int runSetSample(char* trace_fn, int s, int E, int b,
+                 const cache_policy_t* policy, double rate);
+
+/*
+ * runTimeShards - Cut the trace file, which must not be compressed,
+ *     into nchunks contiguous chunks and simulate each on its own 2^s
+ *     set, E way, 2^b byte block cache, using up to nthreads threads
+ *     (0 picks one per online CPU) that each decode their own chunks.
+ *     Each chunk first replays the warmup records before it (a default
+ *     sized to the cache if negative) without counting them.  Prints
+ *     the merged hits, misses and evictions and bounds on their error,
+ *     which hold for LRU only, so policy must be LRU.
+ *     Returns 0 on success.
+ */
+int runTimeShards(char* trace_fn, int s, int E, int b,
+                  const cache_policy_t* policy, int nchunks,
+                  long long warmup, int nthreads);
+
+#endif /* CSIM_H */
@@ -0,0 +1,335 @@
+/*
+ * hierarchy.c - Multi-level cache hierarchies built from cache_t
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "csim.h"
+#include "hierarchy.h"
+#include "timing.h"
+
+/* Level names in the order the levels are stacked */
+static const char* level_names[] = { "l1i", "l1d", "l1", "l2", "l3", "llc" };
+#define NUM_LEVEL_NAMES 6
+
+/*
+ * parseLevel - Parse "s:E:b" or "s:E:b:policy" and create the cache.
+ *     Returns 0 on success.
+ */
+static int parseLevel(const char* name, char* value, cache_t* cache,
+                      const cache_policy_t* policy)
+{
+    int s, E, b, used = 0;
+    char* policy_name;
+
+    if (sscanf(value, "%d:%d:%d%n", &s, &E, &b, &used) != 3) {
+        fprintf(stderr, "Bad geometry for %s: %s\n", name, value);
+        return -1;
+    }
+    policy_name = value + used;
+    if (*policy_name == ':') {
+        policy = findPolicy(policy_name + 1);
+        if (!policy) {
+            fprintf(stderr, "Unknown replacement policy for %s: %s\n",
+                    name, policy_name + 1);
+            return -1;
+        }
+    } else if (*policy_name != '\0') {
+        fprintf(stderr, "Bad geometry for %s: %s\n", name, value);
+        return -1;
+    }
+    if (initCache(cache, s, E, b, policy) < 0) {
+        fprintf(stderr, "Cannot simulate %s with s=%d E=%d b=%d\n",
+                name, s, E, b);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * initHierarchy - Build a hierarchy from a spec
+ */
+int initHierarchy(hierarchy_t* h, const char* spec,
+                  const cache_policy_t* policy)
+{
+    char* values[NUM_LEVEL_NAMES] = { NULL };
+    char* copy = strdup(spec);
+    char* line;
+    char* save_line = NULL;
+    int i;
+
+    memset(h, 0, sizeof(hierarchy_t));
+    h->inclusion = NINE;
+    h->l1i = -1;
+
+    /* collect name=value entries, dropping comments */
+    for (line = strtok_r(copy, "\n", &save_line); line;
+         line = strtok_r(NULL, "\n", &save_line)) {
+        char* save = NULL;
+        char* entry;
+        char* hash = strchr(line, '#');
+
+        if (hash)
+            *hash = '\0';
+        for (entry = strtok_r(line, " \t\r,", &save); entry;
+             entry = strtok_r(NULL, " \t\r,", &save)) {
+            char* eq = strchr(entry, '=');
+            if (!eq) {
+                fprintf(stderr, "Bad hierarchy entry: %s\n", entry);
+                goto fail;
+            }
+            *eq = '\0';
+            if (strcmp(entry, "inclusion") == 0) {
+                if (strcmp(eq + 1, "inclusive") == 0)
+                    h->inclusion = INCLUSIVE;
+                else if (strcmp(eq + 1, "exclusive") == 0)
+                    h->inclusion = EXCLUSIVE;
+                else if (strcmp(eq + 1, "nine") == 0)
+                    h->inclusion = NINE;
+                else {
+                    fprintf(stderr, "Unknown inclusion policy: %s\n", eq + 1);
+                    goto fail;
+                }
+                continue;
+            }
+            for (i = 0; i < NUM_LEVEL_NAMES; i++)
+                if (strcmp(entry, level_names[i]) == 0)
+                    break;
+            if (i == NUM_LEVEL_NAMES) {
+                fprintf(stderr, "Unknown cache level: %s\n", entry);
+                goto fail;
+            }
+            values[i] = eq + 1;
+        }
+    }
+
+    if (values[2] && (values[0] || values[1])) {
+        fprintf(stderr, "Give either l1 or l1i and l1d, not both\n");
+        goto fail;
+    }
+    if (!values[1] && !values[2]) {
+        fprintf(stderr, "The hierarchy needs an l1 or l1d cache\n");
+        goto fail;
+    }
+
+    for (i = 0; i < NUM_LEVEL_NAMES; i++) {
+        hier_level_t* level;
+
+        if (!values[i])
+            continue;
+        level = &h->levels[h->nlevels];
+        level->name = level_names[i];
+        if (parseLevel(level->name, values[i], &level->cache, policy) < 0)
+            goto fail;
+        if (h->nlevels > 0 && level->cache.b != h->levels[0].cache.b) {
+            fprintf(stderr, "All levels must have the same block size\n");
+            h->nlevels++;
+            goto fail;
+        }
+        if (i == 0)
+            h->l1i = h->nlevels;
+        else if (i <= 2)
+            h->l1d = h->nlevels;
+        h->nlevels++;
+        if (i <= 2)
+            h->first_shared = h->nlevels;
+    }
+    free(copy);
+    return 0;
+
+fail:
+    freeHierarchy(h);
+    free(copy);
+    return -1;
+}
+
+/*
+ * freeHierarchy - free allocated memory
+ */
+void freeHierarchy(hierarchy_t* h)
+{
+    for (int i = 0; i < h->nlevels; i++)
+        freeCache(&h->levels[i].cache);
+    h->nlevels = 0;
+}
+
+/*
+ * insertBlock - Fill addr into level i, keeping inclusion: when an
+ *     inclusive level below L1 evicts a block, every level above it
+ *     loses its copy too.
+ */
+static void insertBlock(hierarchy_t* h, int i, mem_addr_t addr)
+{
+    mem_addr_t victim;
+
+    if (!fillCache(&h->levels[i].cache, addr, &victim))
+        return;
+    h->levels[i].cache.eviction_count++;
+    if (h->inclusion != INCLUSIVE || i < h->first_shared)
+        return;
+    for (int j = 0; j < i; j++)
+        if (invalidateBlock(&h->levels[j].cache, victim))
+            h->levels[j].back_invalidations++;
+}
+
+/*
+ * insertExclusive - Fill addr into the path level k and push each
+ *     victim one level further down; the last level drops its victim.
+ */
+static void insertExclusive(hierarchy_t* h, const int* path, int npath,
+                            int k, mem_addr_t addr)
+{
+    for (; k < npath; k++) {
+        cache_t* cache = &h->levels[path[k]].cache;
+
+        /* another L1 may have pushed the same block down already */
+        if (k > 0 && probeCache(cache, addr) >= 0)
+            return;
+        if (!fillCache(cache, addr, &addr))
+            return;
+        cache->eviction_count++;
+    }
+}
+
+/*
+ * accessHierarchy - Access addr through the instruction or data L1
+ */
+int accessHierarchy(hierarchy_t* h, mem_addr_t addr, int instruction)
+{
+    int path[HIER_MAX_LEVELS];
+    int npath = 0, k, j;
+
+    path[npath++] = instruction && h->l1i >= 0 ? h->l1i : h->l1d;
+    for (j = h->first_shared; j < h->nlevels; j++)
+        path[npath++] = j;
+
+    /* walk down until a level hits */
+    for (k = 0; k < npath; k++) {
+        if (probeCache(&h->levels[path[k]].cache, addr) >= 0) {
+            h->levels[path[k]].cache.hit_count++;
+            break;
+        }
+        h->levels[path[k]].cache.miss_count++;
+    }
+    if (k == npath)
+        h->memory_accesses++;
+    if (k == 0)
+        return path[0];
+
+    if (h->inclusion == EXCLUSIVE) {
+        /* the block moves up into L1 */
+        if (k < npath)
+            invalidateBlock(&h->levels[path[k]].cache, addr);
+        insertExclusive(h, path, npath, 0, addr);
+    } else {
+        /* fill from the bottom so that inclusion holds at every step */
+        for (j = k - 1; j >= 0; j--)
+            insertBlock(h, path[j], addr);
+    }
+    return k < npath ? path[k] : h->nlevels;
+}
+
+/*
+ * printHierarchy - Print the counters of every level
+ */
+void printHierarchy(const hierarchy_t* h, FILE* fp)
+{
+    for (int i = 0; i < h->nlevels; i++) {
+        const hier_level_t* level = &h->levels[i];
+        fprintf(fp, "%s hits:%llu misses:%llu evictions:%llu",
+                level->name, level->cache.hit_count, level->cache.miss_count,
+                level->cache.eviction_count);
+        if (h->inclusion == INCLUSIVE)
+            fprintf(fp, " back_invalidations:%llu", level->back_invalidations);
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "memory accesses:%llu\n", h->memory_accesses);
+}
+
+/*
+ * readSpec - Return the contents of spec_arg if it names a readable
+ *     file, else a copy of spec_arg itself
+ */
+static char* readSpec(const char* spec_arg)
+{
+    FILE* fp = strchr(spec_arg, '=') ? NULL : fopen(spec_arg, "r");
+    char* text;
+    long len;
+
+    if (!fp)
+        return strdup(spec_arg);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    rewind(fp);
+    text = malloc(len + 1);
+    len = (long)fread(text, 1, len, fp);
+    text[len] = '\0';
+    fclose(fp);
+    return text;
+}
+
+/*
+ * runHierarchy - Replay a trace through a cache hierarchy
+ */
+int runHierarchy(char* trace_fn, char* spec, const cache_policy_t* policy,
+                 const char* timing_spec)
+{
+    trace_access_t batch[TRACE_BATCH];
+    trace_reader_t* tr;
+    hierarchy_t h;
+    timing_t timing;
+    char* text = readSpec(spec);
+    size_t n;
+    int err = initHierarchy(&h, text, policy);
+
+    free(text);
+    if (err < 0)
+        return -1;
+    /* split L1 caches share the L1 latency */
+    if (timing_spec &&
+        initTiming(&timing, timing_spec, h.nlevels - h.first_shared + 1,
+                   h.levels[0].cache.b) < 0) {
+        freeHierarchy(&h);
+        return -1;
+    }
+    tr = traceOpen(trace_fn);
+    if (!tr) {
+        if (timing_spec)
+            freeTiming(&timing);
+        freeHierarchy(&h);
+        return -1;
+    }
+    traceStartReadAhead(tr);
+
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const trace_access_t* access = &batch[i];
+
+            /* instruction fetches only matter with a split L1 */
+            if (access->op == 'I') {
+                if (h.l1i >= 0)
+                    accessHierarchy(&h, access->addr, 1);
+                continue;
+            }
+            /* a modify is a load followed by a store */
+            for (int k = access->op == 'M' ? 2 : 1; k > 0; k--) {
+                int level = accessHierarchy(&h, access->addr, 0);
+                if (timing_spec)
+                    timingAccess(&timing, access->addr,
+                                 level < h.first_shared
+                                 ? 0 : level - h.first_shared + 1,
+                                 level >= h.first_shared, 0);
+            }
+        }
+    }
+    traceClose(tr);
+
+    printHierarchy(&h, stdout);
+    if (timing_spec) {
+        printTiming(&timing, stdout);
+        freeTiming(&timing);
+    }
+    freeHierarchy(&h);
+    return 0;
+}
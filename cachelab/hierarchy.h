@@ -0,0 +1,69 @@
+/*
+ * hierarchy.h - Multi-level cache hierarchies built from cache_t
+ *
+ * A hierarchy has either a unified L1 or split L1 instruction and data
+ * caches, followed by any of a unified L2, L3 and LLC.  All levels
+ * share one block size.  Three inclusion policies are modelled:
+ *
+ *   inclusive  a miss fills every level; a block evicted from a lower
+ *              level is invalidated in every level above it
+ *   exclusive  a block lives in one level only: misses fill L1, hits
+ *              below L1 move the block up, and every victim moves down
+ *              one level
+ *   nine       non-inclusive, non-exclusive: a miss fills every level
+ *              and evictions are never propagated
+ */
+#ifndef CSIM_HIERARCHY_H
+#define CSIM_HIERARCHY_H
+
+#include <stdio.h>
+#include "cache.h"
+
+#define HIER_MAX_LEVELS 5
+
+typedef enum { INCLUSIVE, EXCLUSIVE, NINE } inclusion_t;
+
+/* Type: One cache of the hierarchy and its counters */
+typedef struct hier_level {
+    const char* name;  /* "l1", "l1i", "l1d", "l2", "l3" or "llc" */
+    cache_t cache;     /* hit, miss and eviction counts live in here */
+    unsigned long long int back_invalidations;
+} hier_level_t;
+
+/* Type: A cache hierarchy */
+typedef struct hierarchy {
+    hier_level_t levels[HIER_MAX_LEVELS];
+    int nlevels;
+    int l1i;           /* index of the instruction L1, or -1 */
+    int l1d;           /* index of the data (or unified) L1 */
+    int first_shared;  /* index of the first level below L1 */
+    inclusion_t inclusion;
+    unsigned long long int memory_accesses;
+} hierarchy_t;
+
+/*
+ * initHierarchy - Build a hierarchy from a spec such as
+ *     "l1i=6:8:6 l1d=6:8:6 l2=9:8:6 llc=12:16:6 inclusion=inclusive".
+ *     Entries are separated by spaces, commas or newlines and '#'
+ *     starts a comment, so spec may also be the contents of a
+ *     configuration file.  A level may name its own replacement policy
+ *     as a fourth field (l2=9:8:6:lru); the others use policy.
+ *     Returns 0 on success or -1 after printing an error.
+ */
+int initHierarchy(hierarchy_t* h, const char* spec,
+                  const cache_policy_t* policy);
+
+/* freeHierarchy - free allocated memory */
+void freeHierarchy(hierarchy_t* h);
+
+/*
+ * accessHierarchy - Access addr through the instruction or the data
+ *     L1.  Returns the index of the level that hit, or nlevels if the
+ *     block came from memory.
+ */
+int accessHierarchy(hierarchy_t* h, mem_addr_t addr, int instruction);
+
+/* printHierarchy - Print the counters of every level */
+void printHierarchy(const hierarchy_t* h, FILE* fp);
+
+#endif /* CSIM_HIERARCHY_H */
@@ -0,0 +1,116 @@
+/*
+ * libcsim.c - C API of the csim cache model, see libcsim.h
+ */
+#include <stdlib.h>
+#include "libcsim.h"
+#include "cache.h"
+
+/* Accesses converted for accessBatch() at a time */
+#define LIBCSIM_CHUNK 256
+
+struct csim_cache {
+    cache_t cache;
+};
+
+/*
+ * csimCreate - Create an empty cache
+ */
+csim_cache_t* csimCreate(int s, int E, int b, const char* policy)
+{
+    const cache_policy_t* p = NULL;
+    csim_cache_t* handle;
+
+    if (policy && !(p = findPolicy(policy)))
+        return NULL;
+    handle = malloc(sizeof(csim_cache_t));
+    if (!handle)
+        return NULL;
+    if (initCache(&handle->cache, s, E, b, p) < 0) {
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+/*
+ * csimDestroy - Free the cache
+ */
+void csimDestroy(csim_cache_t* handle)
+{
+    if (!handle)
+        return;
+    freeCache(&handle->cache);
+    free(handle);
+}
+
+/*
+ * csimSetWritePolicy - Choose how stores are handled
+ */
+void csimSetWritePolicy(csim_cache_t* handle, int write_back,
+                        int write_allocate)
+{
+    handle->cache.write_back = write_back != 0;
+    handle->cache.write_allocate = write_allocate != 0;
+}
+
+/*
+ * csimAccess - Apply one access
+ */
+int csimAccess(csim_cache_t* handle, unsigned long long int addr,
+               unsigned int size, char op)
+{
+    unsigned long long int misses = handle->cache.miss_count;
+    trace_access_t access;
+
+    access.addr = addr;
+    access.size = size;
+    access.op = op;
+    accessTrace(&handle->cache, &access);
+    return handle->cache.miss_count == misses;
+}
+
+/*
+ * csimAccessBatch - Apply n accesses in order, in chunks handed to
+ *     accessBatch() so that upcoming sets are prefetched
+ */
+void csimAccessBatch(csim_cache_t* handle, const csim_access_t* accesses,
+                     size_t n)
+{
+    trace_access_t chunk[LIBCSIM_CHUNK];
+
+    while (n > 0) {
+        size_t m = n < LIBCSIM_CHUNK ? n : LIBCSIM_CHUNK;
+
+        for (size_t i = 0; i < m; i++) {
+            chunk[i].addr = accesses[i].addr;
+            chunk[i].size = accesses[i].size;
+            chunk[i].op = accesses[i].op;
+        }
+        accessBatch(&handle->cache, chunk, m);
+        accesses += m;
+        n -= m;
+    }
+}
+
+/*
+ * csimStats - Copy the counters of the cache
+ */
+void csimStats(const csim_cache_t* handle, csim_stats_t* stats)
+{
+    const cache_t* cache = &handle->cache;
+
+    stats->hits = cache->hit_count;
+    stats->misses = cache->miss_count;
+    stats->evictions = cache->eviction_count;
+    stats->writebacks = cache->writeback_count;
+    stats->bytes_from_next = cache->bytes_from_next;
+    stats->bytes_to_next = cache->bytes_to_next;
+}
+
+/*
+ * csimReset - Empty the cache and clear its counters
+ */
+void csimReset(csim_cache_t* handle)
+{
+    resetCache(&handle->cache);
+}
@@ -0,0 +1,79 @@
+/*
+ * libcsim.h - C API of the csim cache model
+ *
+ * libcsim.a lets other programs simulate caches without running csim
+ * and parsing .csim_results.  Every cache is an independent handle,
+ * so a process may simulate any number of them side by side; a handle
+ * must not be used by two threads at once.
+ *
+ *     csim_cache_t* c = csimCreate(6, 8, 6, "lru");
+ *     csimAccess(c, 0x7ff000a10, 8, 'L');
+ *     csimStats(c, &stats);
+ *     csimDestroy(c);
+ *
+ * Link with -lcsim.  The library exports only the csim* functions
+ * below, so the names of the model inside cannot clash with the
+ * program.
+ */
+#ifndef LIBCSIM_H
+#define LIBCSIM_H
+
+#include <stddef.h>
+
+/* Type: Opaque handle of one simulated cache */
+typedef struct csim_cache csim_cache_t;
+
+/* Type: One memory access, as in a lackey trace */
+typedef struct csim_access {
+    unsigned long long int addr; /* address of the first byte accessed */
+    unsigned int size;           /* number of bytes accessed */
+    char op;                     /* 'L', 'S', 'M' or 'I' (ignored) */
+} csim_access_t;
+
+/* Type: Counters of a cache since it was created or reset */
+typedef struct csim_stats {
+    unsigned long long int hits;
+    unsigned long long int misses;
+    unsigned long long int evictions;
+    unsigned long long int writebacks;      /* dirty lines written back */
+    unsigned long long int bytes_from_next; /* bytes filled from below */
+    unsigned long long int bytes_to_next;   /* bytes written below */
+} csim_stats_t;
+
+/*
+ * csimCreate - Create an empty write-back, write-allocate cache with
+ *     2^s sets of E lines of 2^b bytes.  policy names a replacement
+ *     policy as accepted by csim -p, NULL for MRU.  Returns NULL if
+ *     the geometry or policy is not supported.
+ */
+csim_cache_t* csimCreate(int s, int E, int b, const char* policy);
+
+/* csimDestroy - Free the cache */
+void csimDestroy(csim_cache_t* cache);
+
+/*
+ * csimSetWritePolicy - Choose write-back (1) or write-through (0), and
+ *     write-allocate (1) or no-write-allocate (0) stores
+ */
+void csimSetWritePolicy(csim_cache_t* cache, int write_back,
+                        int write_allocate);
+
+/*
+ * csimAccess - Apply one access: loads and stores access the cache
+ *     once, modifies load and then store, instruction fetches are
+ *     ignored.  Returns 1 if every access it made hit, 0 otherwise.
+ */
+int csimAccess(csim_cache_t* cache, unsigned long long int addr,
+               unsigned int size, char op);
+
+/* csimAccessBatch - Apply n accesses in order */
+void csimAccessBatch(csim_cache_t* cache, const csim_access_t* accesses,
+                     size_t n);
+
+/* csimStats - Copy the counters of the cache into stats */
+void csimStats(const csim_cache_t* cache, csim_stats_t* stats);
+
+/* csimReset - Empty the cache and clear its counters */
+void csimReset(csim_cache_t* cache);
+
+#endif /* LIBCSIM_H */
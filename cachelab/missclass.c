@@ -0,0 +1,79 @@
+/*
+ * missclass.c - Compulsory, capacity and conflict miss classification
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "missclass.h"
+
+/*
+ * initMissClass - Set up a classifier and attach it to cache
+ */
+int initMissClass(miss_class_t* mc, cache_t* cache)
+{
+    memset(mc, 0, sizeof(miss_class_t));
+    if (initStackDist(&mc->shadow, 0, cache->b) < 0)
+        return -1;
+    mc->per_set = calloc((size_t)cache->S * MISS_CLASSES,
+                         sizeof(unsigned long long int));
+    if (!mc->per_set) {
+        freeStackDist(&mc->shadow);
+        return -1;
+    }
+    mc->lines = (long long)cache->S * cache->E;
+    mc->cache = cache;
+    cache->classify = mc;
+    return 0;
+}
+
+/*
+ * freeMissClass - free allocated memory
+ */
+void freeMissClass(miss_class_t* mc)
+{
+    freeStackDist(&mc->shadow);
+    free(mc->per_set);
+    mc->per_set = NULL;
+}
+
+/*
+ * missClassAccess - Run the access to addr through the shadow cache
+ */
+void missClassAccess(miss_class_t* mc, mem_addr_t addr)
+{
+    mc->distance = stackDistance(&mc->shadow, addr);
+}
+
+/*
+ * missClassMiss - Classify a miss of the access just passed in
+ */
+void missClassMiss(miss_class_t* mc, mem_addr_t addr)
+{
+    mem_addr_t setIndex = cacheSet(mc->cache, addr, 0);
+    miss_class_kind_t kind;
+
+    if (mc->distance < 0)
+        kind = MISS_COMPULSORY;
+    else if (mc->distance >= mc->lines)
+        kind = MISS_CAPACITY;
+    else
+        kind = MISS_CONFLICT;
+    mc->per_set[setIndex * MISS_CLASSES + kind]++;
+    mc->total[kind]++;
+}
+
+/*
+ * printMissClass - Print the classes of every set, then the totals
+ */
+void printMissClass(const miss_class_t* mc, FILE* fp)
+{
+    for (mem_addr_t set = 0; set < (mem_addr_t)mc->cache->S; set++) {
+        const unsigned long long* row = mc->per_set + set * MISS_CLASSES;
+        fprintf(fp, "set:%llu compulsory:%llu capacity:%llu conflict:%llu\n",
+                set, row[MISS_COMPULSORY], row[MISS_CAPACITY],
+                row[MISS_CONFLICT]);
+    }
+    fprintf(fp, "compulsory:%llu capacity:%llu conflict:%llu\n",
+            mc->total[MISS_COMPULSORY], mc->total[MISS_CAPACITY],
+            mc->total[MISS_CONFLICT]);
+}
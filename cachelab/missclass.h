@@ -0,0 +1,51 @@
+/*
+ * missclass.h - Compulsory, capacity and conflict miss classification
+ *
+ * A miss is compulsory if its block was never accessed before.  Of
+ * the other misses, those a fully-associative LRU cache with the same
+ * number of lines would also have taken are capacity misses, and the
+ * rest are conflict misses.  The shadow cache is an LRU stack distance
+ * engine with a single set: a block hits in it exactly when fewer than
+ * S*E distinct blocks were touched since its previous access, and its
+ * history doubles as the set of blocks already touched.
+ */
+#ifndef CSIM_MISSCLASS_H
+#define CSIM_MISSCLASS_H
+
+#include "cache.h"
+#include "stackdist.h"
+
+/* Type: Miss classes, also the column of a per-set counter row */
+typedef enum { MISS_COMPULSORY, MISS_CAPACITY, MISS_CONFLICT,
+               MISS_CLASSES } miss_class_kind_t;
+
+/* Type: 3C classifier attached to one cache */
+typedef struct miss_class {
+    stack_dist_t shadow;    /* fully-associative LRU shadow cache */
+    long long lines;        /* lines of the shadow cache, S*E */
+    long long distance;     /* shadow distance of the current access */
+    const cache_t* cache;   /* the classified cache */
+    unsigned long long int* per_set; /* MISS_CLASSES counters per set */
+    unsigned long long int total[MISS_CLASSES];
+} miss_class_t;
+
+/*
+ * initMissClass - Set up a classifier for cache and attach it, so that
+ *     accessData() and writeData() classify every miss they count.
+ *     Returns 0 on success.
+ */
+int initMissClass(miss_class_t* mc, cache_t* cache);
+
+/* freeMissClass - free allocated memory */
+void freeMissClass(miss_class_t* mc);
+
+/* missClassAccess - Run the access to addr through the shadow cache */
+void missClassAccess(miss_class_t* mc, mem_addr_t addr);
+
+/* missClassMiss - Classify a miss of the access just passed in */
+void missClassMiss(miss_class_t* mc, mem_addr_t addr);
+
+/* printMissClass - Print the classes of every set and the totals */
+void printMissClass(const miss_class_t* mc, FILE* fp);
+
+#endif /* CSIM_MISSCLASS_H */
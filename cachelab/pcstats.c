@@ -0,0 +1,92 @@
+/*
+ * pcstats.c - Per-instruction miss attribution, see pcstats.h
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "pcstats.h"
+
+/*
+ * initPcTable - Create an empty table
+ */
+int initPcTable(pc_table_t* table)
+{
+    memset(table, 0, sizeof(pc_table_t));
+    return initBlockmap(&table->index);
+}
+
+/*
+ * freePcTable - free allocated memory
+ */
+void freePcTable(pc_table_t* table)
+{
+    freeBlockmap(&table->index);
+    free(table->pcs);
+    table->pcs = NULL;
+    table->npcs = table->capacity = 0;
+}
+
+/*
+ * pcCount - Charge a data record to the current PC
+ */
+void pcCount(pc_table_t* table, const trace_access_t* access,
+             unsigned long long int misses, unsigned long long int evictions)
+{
+    pc_stats_t* pcs;
+    pc_stats_t* stats;
+    size_t index;
+    int created;
+
+    if (access->op == 'I') {
+        table->pc = access->addr;
+        return;
+    }
+    pcs = blockmapRecord(&table->index, table->pc, table->pcs,
+                         sizeof(pc_stats_t), &table->npcs, &table->capacity,
+                         &index, &created);
+    if (!pcs) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    table->pcs = pcs;
+    stats = &pcs[index];
+    if (created)
+        stats->pc = table->pc;
+    stats->accesses += access->op == 'M' ? 2 : 1;
+    stats->misses += misses;
+    stats->evictions += evictions;
+}
+
+/*
+ * comparePcs - Order instructions by misses, then evictions, both
+ *     decreasing
+ */
+static int comparePcs(const void* a, const void* b)
+{
+    const pc_stats_t* pa = a;
+    const pc_stats_t* pb = b;
+
+    if (pa->misses != pb->misses)
+        return pa->misses < pb->misses ? 1 : -1;
+    if (pa->evictions != pb->evictions)
+        return pa->evictions < pb->evictions ? 1 : -1;
+    return pa->pc < pb->pc ? -1 : pa->pc > pb->pc;
+}
+
+/*
+ * printPcTable - Print the instructions with the most misses
+ */
+void printPcTable(pc_table_t* table, size_t limit, FILE* fp)
+{
+    size_t nshown = table->npcs;
+
+    /* the index is stale once sorted, so the table is done after this */
+    qsort(table->pcs, table->npcs, sizeof(pc_stats_t), comparePcs);
+    if (limit && nshown > limit)
+        nshown = limit;
+    for (size_t i = 0; i < nshown; i++) {
+        const pc_stats_t* stats = &table->pcs[i];
+        fprintf(fp, "pc %llx accesses:%llu misses:%llu evictions:%llu\n",
+                stats->pc, stats->accesses, stats->misses, stats->evictions);
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * pcstats.h - Data misses and evictions attributed to instructions
+ *
+ * Every data access is charged to the instruction that made it, the
+ * address of the latest 'I' record before it in the trace.  Accesses
+ * before the first 'I' record are charged to PC 0.
+ */
+#ifndef CSIM_PCSTATS_H
+#define CSIM_PCSTATS_H
+
+#include <stdio.h>
+#include "cache.h"
+#include "blockmap.h"
+
+/* Type: Counters of one instruction */
+typedef struct pc_stats {
+    mem_addr_t pc;
+    unsigned long long int accesses;
+    unsigned long long int misses;
+    unsigned long long int evictions;
+} pc_stats_t;
+
+/* Type: Table of the instructions seen so far */
+typedef struct pc_table {
+    mem_addr_t pc;     /* address of the latest instruction record */
+    blockmap_t index;  /* pc -> index into pcs */
+    pc_stats_t* pcs;
+    size_t npcs, capacity;
+} pc_table_t;
+
+/* initPcTable - Create an empty table. Returns 0 on success */
+int initPcTable(pc_table_t* table);
+
+/* freePcTable - free allocated memory */
+void freePcTable(pc_table_t* table);
+
+/*
+ * pcCount - Follow one trace record: an instruction record becomes
+ *     the current PC, a data record charges it with its accesses and
+ *     the misses and evictions they caused
+ */
+void pcCount(pc_table_t* table, const trace_access_t* access,
+             unsigned long long int misses, unsigned long long int evictions);
+
+/*
+ * printPcTable - Print the instructions by decreasing misses, at most
+ *     limit of them unless limit is 0
+ */
+void printPcTable(pc_table_t* table, size_t limit, FILE* fp);
+
+#endif /* CSIM_PCSTATS_H */
@@ -0,0 +1,251 @@
+/*
+ * policy.c - Replacement policies for the simulated cache
+ *
+ * A policy only ever sees full sets: the cache fills invalid lines
+ * itself, lowest way first, and asks the policy for a victim once
+ * every line of the set is valid.  Each policy keeps its state in a
+ * few bytes of per-set metadata instead of a counter per line:
+ *
+ *   lru, mru, fifo  recency (or insertion) rank of every way, 1 byte
+ *                   each, padded to 16 bytes for SSE2
+ *   random          nothing; one generator per cache
+ *   plru            the E - 1 node bits of a binary tree
+ *   srrip           a 2-bit re-reference prediction value per way
+ */
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "cache.h"
+
+/* SRRIP: values of the 2-bit re-reference prediction */
+#define RRPV_MAX 3          /* predicted far in the future: evict */
+#define RRPV_INSERT 2       /* new lines are assumed to be reused late */
+
+/*
+ * Rank based policies (lru, mru, fifo).  meta[way] is the position of
+ * the way in the recency stack, 0 for the most recently used.  The
+ * ranks are padded with 0xff up to a multiple of 16 bytes so that
+ * they can be updated and searched 16 ways at a time.
+ */
+#define RANK_PAD 16
+
+static int rankMetaSize(int E)
+{
+    /* the 0xff padding ranks above every real way as long as E fits
+       in a byte; E = 256 needs no padding */
+    if (E > 256)
+        return -1;
+    return (E + RANK_PAD - 1) & ~(RANK_PAD - 1);
+}
+
+static void rankInit(cache_t* cache, unsigned char* meta)
+{
+    memset(meta, 0xff, cache->meta_size);
+    for (int way = 0; way < cache->E; way++)
+        meta[way] = (unsigned char)way;
+}
+
+static void rankPromote(cache_t* cache, unsigned char* meta, int way)
+{
+    unsigned char rank = meta[way];
+
+    /* every way more recent than this one moves down by one */
+#if defined(__SSE2__)
+    __m128i r = _mm_set1_epi8((char)rank);
+    for (int i = 0; i < cache->meta_size; i += RANK_PAD) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(meta + i));
+        /* v <= rank, as a mask of all-ones bytes; subtracting adds 1 */
+        __m128i le = _mm_cmpeq_epi8(_mm_max_epu8(v, r), r);
+        _mm_storeu_si128((__m128i*)(meta + i), _mm_sub_epi8(v, le));
+    }
+#else
+    for (int i = 0; i < cache->E; i++)
+        if (meta[i] < rank)
+            meta[i]++;
+#endif
+    meta[way] = 0;
+}
+
+/*
+ * rankFind - Way holding the given rank
+ */
+static int rankFind(cache_t* cache, const unsigned char* meta,
+                    unsigned char rank)
+{
+#if defined(__SSE2__)
+    __m128i r = _mm_set1_epi8((char)rank);
+    for (int i = 0; i < cache->meta_size; i += RANK_PAD) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(meta + i));
+        int match = _mm_movemask_epi8(_mm_cmpeq_epi8(v, r));
+        if (match)
+            return i + __builtin_ctz(match);
+    }
+#else
+    for (int i = 0; i < cache->E; i++)
+        if (meta[i] == rank)
+            return i;
+#endif
+    return 0;
+}
+
+static int rankOldest(cache_t* cache, unsigned char* meta)
+{
+    return rankFind(cache, meta, (unsigned char)(cache->E - 1));
+}
+
+static int rankNewest(cache_t* cache, unsigned char* meta)
+{
+    return rankFind(cache, meta, 0);
+}
+
+static void noTouch(cache_t* cache, unsigned char* meta, int way)
+{
+    /* fifo ignores hits, random ignores everything */
+    (void)cache;
+    (void)meta;
+    (void)way;
+}
+
+/*
+ * Random replacement, driven by a xorshift generator per cache so that
+ * runs are reproducible.
+ */
+static int noMetaSize(int E)
+{
+    (void)E;
+    return 0;
+}
+
+static void noInit(cache_t* cache, unsigned char* meta)
+{
+    (void)cache;
+    (void)meta;
+}
+
+static int randomVictim(cache_t* cache, unsigned char* meta)
+{
+    unsigned long long x = cache->rng;
+
+    (void)meta;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    cache->rng = x;
+    return (int)(x % cache->E);
+}
+
+/*
+ * Tree pseudo-LRU.  Node n (1 to E - 1) has children 2n and 2n + 1,
+ * and its bit tells on which side the victim should be looked for:
+ * 0 for the left subtree, 1 for the right one.
+ */
+static inline int getBit(const unsigned char* meta, int n)
+{
+    return (meta[n >> 3] >> (n & 7)) & 1;
+}
+
+static inline void setBit(unsigned char* meta, int n, int v)
+{
+    meta[n >> 3] = (unsigned char)((meta[n >> 3] & ~(1 << (n & 7))) |
+                                   (v << (n & 7)));
+}
+
+static int plruMetaSize(int E)
+{
+    /* needs a power of two; bit 0 of the first byte is unused */
+    if (E & (E - 1))
+        return -1;
+    return (E + 7) / 8;
+}
+
+static void plruTouch(cache_t* cache, unsigned char* meta, int way)
+{
+    /* walk down to the way and point every node away from it */
+    int n = 1;
+
+    for (int half = cache->E / 2; half > 0; half /= 2) {
+        int right = (way & half) != 0;
+        setBit(meta, n, !right);
+        n = 2 * n + right;
+    }
+}
+
+static int plruVictim(cache_t* cache, unsigned char* meta)
+{
+    int n = 1, way = 0;
+
+    for (int half = cache->E / 2; half > 0; half /= 2) {
+        int right = getBit(meta, n);
+        if (right)
+            way |= half;
+        n = 2 * n + right;
+    }
+    return way;
+}
+
+/*
+ * Static re-reference interval prediction (SRRIP-HP) with 2-bit values
+ * packed four to a byte.
+ */
+static inline int getRrpv(const unsigned char* meta, int way)
+{
+    return (meta[way >> 2] >> ((way & 3) * 2)) & 3;
+}
+
+static inline void setRrpv(unsigned char* meta, int way, int v)
+{
+    int shift = (way & 3) * 2;
+    meta[way >> 2] = (unsigned char)((meta[way >> 2] & ~(3 << shift)) |
+                                     (v << shift));
+}
+
+static int srripMetaSize(int E)
+{
+    return (E + 3) / 4;
+}
+
+static void srripHit(cache_t* cache, unsigned char* meta, int way)
+{
+    (void)cache;
+    setRrpv(meta, way, 0);
+}
+
+static void srripFill(cache_t* cache, unsigned char* meta, int way)
+{
+    (void)cache;
+    setRrpv(meta, way, RRPV_INSERT);
+}
+
+static int srripVictim(cache_t* cache, unsigned char* meta)
+{
+    for (;;) {
+        for (int way = 0; way < cache->E; way++)
+            if (getRrpv(meta, way) == RRPV_MAX)
+                return way;
+        /* nobody is predicted distant yet: age every line */
+        for (int way = 0; way < cache->E; way++)
+            setRrpv(meta, way, getRrpv(meta, way) + 1);
+    }
+}
+
+static const cache_policy_t policies[] = {
+    { "mru",    rankMetaSize,  rankInit, rankPromote, rankPromote, rankNewest },
+    { "lru",    rankMetaSize,  rankInit, rankPromote, rankPromote, rankOldest },
+    { "fifo",   rankMetaSize,  rankInit, noTouch,    rankPromote, rankOldest },
+    { "random", noMetaSize,    noInit,   noTouch,    noTouch,    randomVictim },
+    { "plru",   plruMetaSize,  noInit,   plruTouch,   plruTouch,   plruVictim },
+    { "srrip",  srripMetaSize, noInit,   srripHit,    srripFill,   srripVictim },
+};
+
+/*
+ * findPolicy - Look up a replacement policy by name
+ */
+const cache_policy_t* findPolicy(const char* name)
+{
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    return NULL;
+}
@@ -0,0 +1,294 @@
+/*
+ * prefetch.c - Hardware prefetcher models, see prefetch.h
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "prefetch.h"
+
+/*
+ * initPrefetcher - Parse spec and set up the prefetcher
+ */
+int initPrefetcher(prefetcher_t* pf, cache_t* cache, const char* spec)
+{
+    char kind[16];
+    int a = -1, b = -1, used = 0;
+    const char* rest;
+
+    memset(pf, 0, sizeof(prefetcher_t));
+    pf->cache = cache;
+    if (sscanf(spec, "%15[a-z]%n", kind, &used) != 1)
+        goto bad;
+    rest = spec + used;
+    if (*rest == ':') {
+        if (sscanf(rest, ":%d%n", &a, &used) != 1)
+            goto bad;
+        rest += used;
+        if (*rest == ':') {
+            if (sscanf(rest, ":%d%n", &b, &used) != 1)
+                goto bad;
+            rest += used;
+        }
+    }
+    if (*rest == ',') {
+        if (sscanf(rest, ",latency=%d%n", &pf->latency, &used) != 1)
+            goto bad;
+        rest += used;
+    }
+    if (*rest != '\0' || pf->latency < 0)
+        goto bad;
+
+    if (strcmp(kind, "next") == 0 && b < 0) {
+        pf->kind = PREFETCH_NEXT;
+        pf->degree = a < 0 ? 1 : a;
+    } else if (strcmp(kind, "stride") == 0) {
+        pf->kind = PREFETCH_STRIDE;
+        pf->entries = a < 0 ? 256 : a;
+        pf->degree = b < 0 ? 1 : b;
+    } else if (strcmp(kind, "stream") == 0) {
+        pf->kind = PREFETCH_STREAM;
+        pf->entries = a < 0 ? 8 : a;
+        pf->depth = b < 0 ? 4 : b;
+    } else {
+        goto bad;
+    }
+    if (pf->degree < 0 || pf->depth < 0 ||
+        (pf->kind != PREFETCH_NEXT && pf->entries < 1))
+        goto bad;
+
+    if (pf->kind == PREFETCH_STRIDE)
+        pf->table = calloc(pf->entries, sizeof(rpt_entry_t));
+    if (pf->kind == PREFETCH_STREAM)
+        pf->streams = calloc(pf->entries, sizeof(stream_t));
+    /* one cache's worth of the latest blocks evicted by prefetches */
+    pf->evictions_kept = (size_t)cache->S * cache->E;
+    pf->evicted = malloc(pf->evictions_kept * sizeof(mem_addr_t));
+    if (initBlockmap(&pf->pending) < 0 || initBlockmap(&pf->polluted) < 0 ||
+        !pf->evicted ||
+        (pf->kind == PREFETCH_STRIDE && !pf->table) ||
+        (pf->kind == PREFETCH_STREAM && !pf->streams)) {
+        fprintf(stderr, "Out of memory\n");
+        freePrefetcher(pf);
+        return -1;
+    }
+    return 0;
+
+bad:
+    fprintf(stderr, "Bad prefetcher: %s\n", spec);
+    return -1;
+}
+
+/*
+ * freePrefetcher - free allocated memory
+ */
+void freePrefetcher(prefetcher_t* pf)
+{
+    free(pf->table);
+    free(pf->streams);
+    free(pf->evicted);
+    pf->table = NULL;
+    pf->streams = NULL;
+    pf->evicted = NULL;
+    freeBlockmap(&pf->pending);
+    freeBlockmap(&pf->polluted);
+}
+
+/*
+ * notePolluted - Remember that a prefetch evicted block.  Only the
+ *     latest evictions_kept such blocks are remembered, as the cache
+ *     would have turned over and evicted older ones by itself.
+ */
+static void notePolluted(prefetcher_t* pf, mem_addr_t block)
+{
+    size_t slot = pf->evictions % pf->evictions_kept;
+    unsigned long long int* seq;
+    int created;
+
+    /* forget the block in the slot unless it was evicted again since */
+    if (pf->evictions >= pf->evictions_kept &&
+        (seq = blockmapFind(&pf->polluted, pf->evicted[slot])) &&
+        *seq == pf->evictions - pf->evictions_kept)
+        blockmapRemove(&pf->polluted, pf->evicted[slot]);
+    pf->evicted[slot] = block;
+    *blockmapInsert(&pf->polluted, block, &created) = pf->evictions++;
+}
+
+/*
+ * issue - Prefetch block into the cache unless it is already cached.
+ *     The fill takes the path of a demand miss, victim cache included.
+ */
+static void issue(prefetcher_t* pf, mem_addr_t block)
+{
+    cache_t* cache = pf->cache;
+    mem_addr_t addr = block << cache->b;
+    mem_addr_t victim;
+    int created;
+
+    if (lookupCache(cache, addr) >= 0)
+        return;
+    pf->issued++;
+    if (fetchBlock(cache, addr, &victim, 0) != FILL_EMPTY) {
+        notePolluted(pf, victim >> cache->b);
+        blockmapRemove(&pf->pending, victim >> cache->b);
+    }
+    blockmapRemove(&pf->polluted, block);
+    *blockmapInsert(&pf->pending, block, &created) = pf->now + pf->latency;
+}
+
+/*
+ * trainStride - Update the table entry of the current PC and prefetch
+ *     along its stride once it is confirmed
+ */
+static void trainStride(prefetcher_t* pf, mem_addr_t addr)
+{
+    rpt_entry_t* entry = &pf->table[(pf->pc ^ (pf->pc >> 12)) % pf->entries];
+    long long stride;
+    mem_addr_t last_block;
+
+    if (!entry->valid || entry->pc != pf->pc) {
+        entry->valid = 1;
+        entry->pc = pf->pc;
+        entry->last_addr = addr;
+        entry->stride = 0;
+        entry->confidence = 0;
+        return;
+    }
+    stride = (long long)(addr - entry->last_addr);
+    entry->last_addr = addr;
+    if (stride == entry->stride) {
+        if (entry->confidence < 3)
+            entry->confidence++;
+    } else if (entry->confidence > 0) {
+        entry->confidence--;
+    } else {
+        entry->stride = stride;
+    }
+    if (entry->confidence < 2 || entry->stride == 0)
+        return;
+
+    /* several strides may fall into one block */
+    last_block = addr >> pf->cache->b;
+    for (int k = 1; k <= pf->degree; k++) {
+        mem_addr_t block = (addr + k * entry->stride) >> pf->cache->b;
+        if (block != last_block)
+            issue(pf, block);
+        last_block = block;
+    }
+}
+
+/*
+ * trainStream - Keep the stream covering block running ahead, or start
+ *     one on a miss
+ */
+static void trainStream(prefetcher_t* pf, mem_addr_t block, int miss)
+{
+    stream_t* stream = NULL;
+    int i;
+
+    /* a stream covers the depth blocks after its latest block */
+    for (i = 0; i < pf->entries && !stream; i++) {
+        stream_t* s = &pf->streams[i];
+        if (s->valid && block > s->last_block &&
+            block <= s->last_block + pf->depth)
+            stream = s;
+    }
+    if (!stream) {
+        if (!miss)
+            return;
+        /* replace an unused or else the least recently used stream */
+        stream = &pf->streams[0];
+        for (i = 1; i < pf->entries && stream->valid; i++)
+            if (!pf->streams[i].valid ||
+                pf->streams[i].last_use < stream->last_use)
+                stream = &pf->streams[i];
+        stream->valid = 1;
+        stream->next_block = block + 1;
+    }
+    stream->last_block = block;
+    stream->last_use = pf->now;
+    if (stream->next_block < block + 1)
+        stream->next_block = block + 1;
+    for (; stream->next_block <= block + pf->depth; stream->next_block++)
+        issue(pf, stream->next_block);
+}
+
+/*
+ * demand - One demand load or store, followed by training
+ */
+static void demand(prefetcher_t* pf, mem_addr_t addr, unsigned int size,
+                   int write)
+{
+    cache_t* cache = pf->cache;
+    mem_addr_t block = addr >> cache->b;
+    unsigned long long int misses = cache->miss_count;
+    unsigned long long int* arrival;
+    int trigger;
+
+    pf->now++;
+    if (write)
+        writeData(cache, addr, size);
+    else
+        accessData(cache, addr);
+
+    if (cache->miss_count != misses) {
+        /* a prefetched line evicted unused does not count as useful */
+        blockmapRemove(&pf->pending, block);
+        if (blockmapFind(&pf->polluted, block)) {
+            pf->polluting++;
+            blockmapRemove(&pf->polluted, block);
+        }
+        trigger = 1;
+    } else if ((arrival = blockmapFind(&pf->pending, block))) {
+        if (*arrival > pf->now) {
+            /* the demand access waited for the fill: not a hit */
+            cache->hit_count--;
+            pf->late++;
+        } else
+            pf->useful++;
+        blockmapRemove(&pf->pending, block);
+        trigger = 1;
+    } else {
+        trigger = 0;
+    }
+
+    switch (pf->kind) {
+    case PREFETCH_NEXT:
+        if (trigger)
+            for (int k = 1; k <= pf->degree; k++)
+                issue(pf, block + k);
+        break;
+    case PREFETCH_STRIDE:
+        trainStride(pf, addr);
+        break;
+    case PREFETCH_STREAM:
+        if (trigger)
+            trainStream(pf, block, cache->miss_count != misses);
+        break;
+    }
+}
+
+/*
+ * prefetchAccess - Apply one trace record with prefetching
+ */
+void prefetchAccess(prefetcher_t* pf, const trace_access_t* access)
+{
+    if (access->op == 'I') {
+        pf->pc = access->addr;
+        return;
+    }
+    /* a modify is a load followed by a store */
+    if (access->op != 'S')
+        demand(pf, access->addr, access->size, 0);
+    if (access->op != 'L')
+        demand(pf, access->addr, access->size, 1);
+}
+
+/*
+ * printPrefetcher - Print the prefetch counters
+ */
+void printPrefetcher(const prefetcher_t* pf, FILE* fp)
+{
+    fprintf(fp, "prefetches issued:%llu useful:%llu late:%llu unused:%llu "
+            "polluting:%llu\n", pf->issued, pf->useful, pf->late,
+            pf->issued - pf->useful - pf->late, pf->polluting);
+}
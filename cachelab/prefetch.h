@@ -0,0 +1,102 @@
+/*
+ * prefetch.h - Hardware prefetcher models
+ *
+ * A prefetcher watches the demand accesses replayed against a cache
+ * and fills the blocks it predicts straight into that cache:
+ *
+ *   next    Tagged next-line: a miss, or the first hit on a prefetched
+ *           line, prefetches the next degree blocks.
+ *   stride  Reference prediction table indexed by the PC of the
+ *           instruction making the access (the address of the latest
+ *           'I' record).  Once an entry has seen the same stride
+ *           twice it prefetches degree strides ahead.
+ *   stream  Stream buffers: a miss starts a stream, and misses or
+ *           prefetched hits within depth blocks ahead of a stream keep
+ *           it running depth blocks ahead.  Streams ascend.
+ *
+ * A prefetch is useful if its line is hit by a demand access before
+ * being evicted, and late if that hit comes sooner than latency demand
+ * accesses after the prefetch was issued.  The demand access of a late
+ * prefetch waits for the fill in flight, so it is counted as late
+ * instead of as a hit of the cache.  A prefetch is polluting if
+ * the line it evicted misses again before being refilled otherwise,
+ * and before prefetches have evicted as many lines as the cache holds.
+ * Prefetches fill the cache like demand misses, through the victim
+ * cache if there is one, but are not counted as its lookups.
+ */
+#ifndef CSIM_PREFETCH_H
+#define CSIM_PREFETCH_H
+
+#include <stdio.h>
+#include "cache.h"
+#include "blockmap.h"
+
+/* Type: Prefetch algorithm */
+typedef enum {
+    PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_STREAM
+} prefetch_kind_t;
+
+/* Type: One reference prediction table entry */
+typedef struct rpt_entry {
+    mem_addr_t pc;
+    mem_addr_t last_addr;
+    long long stride;
+    int confidence; /* 0 to 3, prefetch from 2 */
+    int valid;
+} rpt_entry_t;
+
+/* Type: One stream buffer */
+typedef struct stream {
+    mem_addr_t last_block; /* latest demand block of the stream */
+    mem_addr_t next_block; /* first block not prefetched yet */
+    unsigned long long int last_use;
+    int valid;
+} stream_t;
+
+/* Type: Prefetcher attached to one cache */
+typedef struct prefetcher {
+    prefetch_kind_t kind;
+    cache_t* cache;
+    int degree;         /* next, stride: blocks or strides ahead */
+    int entries;        /* stride: table entries, stream: buffers */
+    int depth;          /* stream: blocks kept ahead */
+    int latency;        /* demand accesses until a prefetch arrives */
+
+    rpt_entry_t* table;
+    stream_t* streams;
+    mem_addr_t pc;      /* address of the latest instruction record */
+    unsigned long long int now; /* demand accesses so far */
+
+    blockmap_t pending;  /* prefetched, unused blocks -> arrival time */
+    blockmap_t polluted; /* blocks evicted by prefetches -> sequence */
+    mem_addr_t* evicted; /* ring of the latest blocks evicted by them */
+    size_t evictions_kept; /* size of the ring: lines in the cache */
+    unsigned long long int evictions; /* evicted by prefetches so far */
+
+    unsigned long long int issued;
+    unsigned long long int useful;
+    unsigned long long int late;
+    unsigned long long int polluting;
+} prefetcher_t;
+
+/*
+ * initPrefetcher - Set up a prefetcher for cache from a spec of the
+ *     form kind[:a[:b]][,latency=n]: "next[:degree]",
+ *     "stride[:entries[:degree]]" or "stream[:buffers[:depth]]".
+ *     Returns 0 on success, -1 after printing an error.
+ */
+int initPrefetcher(prefetcher_t* pf, cache_t* cache, const char* spec);
+
+/* freePrefetcher - free allocated memory */
+void freePrefetcher(prefetcher_t* pf);
+
+/*
+ * prefetchAccess - Apply one trace record to the cache like
+ *     accessTrace(), then let the prefetcher react to it
+ */
+void prefetchAccess(prefetcher_t* pf, const trace_access_t* access);
+
+/* printPrefetcher - Print the prefetch counters */
+void printPrefetcher(const prefetcher_t* pf, FILE* fp);
+
+#endif /* CSIM_PREFETCH_H */
@@ -0,0 +1,206 @@
+/*
+ * setsample.c - Fast estimates by simulating a sample of the sets
+ *
+ * A set is sampled when the low bits of a hash of its index fall below
+ * rate * 2^24, so the choice is deterministic and spread evenly over
+ * the index space.  Accesses are decomposed into their set index as
+ * they are read, and those of unsampled sets are dropped before the
+ * cache is touched.  Sets of a cache evolve independently, so the
+ * sampled sets behave exactly as in a full simulation.
+ *
+ * The miss and eviction ratios are ratio estimates over the sampled
+ * sets, scaled by the exact number of accesses in the trace.  Their
+ * 95% confidence intervals treat every sampled set as one cluster of
+ * accesses, with the finite population correction for sampling a
+ * fraction of the sets.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "csim.h"
+
+#define SETSAMPLE_MODULUS (1 << 24)
+
+/* Type: Counters of one sampled set */
+typedef struct sample_set {
+    unsigned long long int accesses;
+    unsigned long long int misses;
+    unsigned long long int evictions;
+} sample_set_t;
+
+/*
+ * hashSet - Mix the bits of a set index (splitmix64 finalizer)
+ */
+static inline unsigned long long hashSet(mem_addr_t set)
+{
+    set ^= set >> 30;
+    set *= 0xbf58476d1ce4e5b9ULL;
+    set ^= set >> 27;
+    set *= 0x94d049bb133111ebULL;
+    return set ^ (set >> 31);
+}
+
+/*
+ * ratioError - Half width of the 95% confidence interval of the ratio
+ *     estimate sum(y) / sum(x) over n of N clusters
+ */
+static double ratioError(const sample_set_t* sets, const int* sampled, int n,
+                         int N, double ratio, int evictions)
+{
+    double mean_x = 0, var = 0;
+
+    if (n < 2)
+        return NAN;
+    for (int i = 0; i < n; i++) {
+        const sample_set_t* set = &sets[sampled[i]];
+        double y = evictions ? set->evictions : set->misses;
+        double d = y - ratio * set->accesses;
+
+        mean_x += (double)set->accesses / n;
+        var += d * d / (n - 1);
+    }
+    if (mean_x == 0)
+        return 0;
+    return 1.96 * sqrt((1 - (double)n / N) * var / n) / mean_x;
+}
+
+/*
+ * clampBound - Keep an interval bound between the count seen in the
+ *     sampled sets, which the whole cache has at least, and the number
+ *     of accesses, which it cannot exceed
+ */
+static double clampBound(double bound, unsigned long long int seen,
+                         unsigned long long int total)
+{
+    if (isnan(bound))
+        return bound;
+    if (bound < seen)
+        return seen;
+    return bound > total ? total : bound;
+}
+
+/*
+ * runSetSample - Simulate the sampled sets and print scaled estimates
+ */
+int runSetSample(char* trace_fn, int s, int E, int b,
+                 const cache_policy_t* policy, double rate)
+{
+    trace_access_t batch[TRACE_BATCH];
+    unsigned long long int total = 0, simulated = 0, misses = 0;
+    unsigned long long int evictions = 0;
+    unsigned char* in_sample;
+    sample_set_t* sets;
+    int* sampled;
+    int nsampled = 0, S, i;
+    unsigned int threshold;
+    trace_reader_t* tr;
+    cache_t cache;
+    double miss_ratio, eviction_ratio, miss_err, eviction_err;
+    size_t n;
+
+    if (rate <= 0 || rate > 1) {
+        fprintf(stderr, "The set sampling rate must be in (0, 1]\n");
+        return -1;
+    }
+    if (initCache(&cache, s, E, b, policy) < 0) {
+        fprintf(stderr, "Cannot simulate s=%d E=%d b=%d\n", s, E, b);
+        return -1;
+    }
+    S = cache.S;
+    in_sample = calloc(S, 1);
+    sets = calloc(S, sizeof(sample_set_t));
+    sampled = malloc(S * sizeof(int));
+    if (!in_sample || !sets || !sampled) {
+        fprintf(stderr, "Out of memory\n");
+        goto fail;
+    }
+
+    /* pick the sets; keep the one with the smallest hash if none is */
+    threshold = (unsigned int)(rate * SETSAMPLE_MODULUS);
+    for (i = 0; i < S; i++) {
+        if ((hashSet(i) & (SETSAMPLE_MODULUS - 1)) < threshold) {
+            in_sample[i] = 1;
+            sampled[nsampled++] = i;
+        }
+    }
+    if (nsampled == 0) {
+        int best = 0;
+        for (i = 1; i < S; i++)
+            if ((hashSet(i) & (SETSAMPLE_MODULUS - 1)) <
+                (hashSet(best) & (SETSAMPLE_MODULUS - 1)))
+                best = i;
+        in_sample[best] = 1;
+        sampled[nsampled++] = best;
+    }
+
+    tr = traceOpen(trace_fn);
+    if (!tr)
+        goto fail;
+    traceStartReadAhead(tr);
+
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        for (size_t k = 0; k < n; k++) {
+            const trace_access_t* access = &batch[k];
+            mem_addr_t set;
+            sample_set_t* counters;
+            unsigned long long before_misses, before_evictions;
+
+            /* same access semantics as accessTrace() */
+            if (access->op == 'I')
+                continue;
+            total += access->op == 'M' ? 2 : 1;
+            set = (access->addr >> b) & cache.set_index_mask;
+            if (!in_sample[set])
+                continue;
+
+            counters = &sets[set];
+            before_misses = cache.miss_count;
+            before_evictions = cache.eviction_count;
+            accessTrace(&cache, access);
+            counters->accesses += access->op == 'M' ? 2 : 1;
+            counters->misses += cache.miss_count - before_misses;
+            counters->evictions += cache.eviction_count - before_evictions;
+        }
+    }
+    traceClose(tr);
+
+    for (i = 0; i < nsampled; i++) {
+        simulated += sets[sampled[i]].accesses;
+        misses += sets[sampled[i]].misses;
+        evictions += sets[sampled[i]].evictions;
+    }
+    miss_ratio = simulated ? (double)misses / simulated : 0;
+    eviction_ratio = simulated ? (double)evictions / simulated : 0;
+    miss_err = ratioError(sets, sampled, nsampled, S, miss_ratio, 0);
+    eviction_err = ratioError(sets, sampled, nsampled, S, eviction_ratio, 1);
+
+    printf("sampled_sets:%d/%d accesses:%llu simulated:%llu\n",
+           nsampled, S, total, simulated);
+    printf("hits:%.0f misses:%.0f evictions:%.0f\n",
+           (1 - miss_ratio) * total, miss_ratio * total,
+           eviction_ratio * total);
+    printf("miss_ratio:%.4f error:%.4f misses:[%.0f,%.0f]\n",
+           miss_ratio, miss_err,
+           clampBound((miss_ratio - miss_err) * total, misses, total),
+           clampBound((miss_ratio + miss_err) * total, misses, total));
+    printf("eviction_ratio:%.4f error:%.4f evictions:[%.0f,%.0f]\n",
+           eviction_ratio, eviction_err,
+           clampBound((eviction_ratio - eviction_err) * total, evictions,
+                      total),
+           clampBound((eviction_ratio + eviction_err) * total, evictions,
+                      total));
+
+    free(in_sample);
+    free(sets);
+    free(sampled);
+    freeCache(&cache);
+    return 0;
+
+fail:
+    free(in_sample);
+    free(sets);
+    free(sampled);
+    freeCache(&cache);
+    return -1;
+}
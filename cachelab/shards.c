@@ -0,0 +1,298 @@
+/*
+ * shards.c - Approximate miss-ratio curves by spatially hashed
+ *     sampling (SHARDS)
+ *
+ * A block is sampled when the low bits of a hash of its block number
+ * fall below a threshold T, so the sampling rate is R = T / 2^24 and
+ * every access to a sampled block is seen.  Stack distances are
+ * computed per set over the sampled blocks only, with the same set
+ * decomposition as the simulated cache, and divided by R to estimate
+ * the distance in the full trace.
+ *
+ * Memory stays bounded by tracking at most max_blocks sampled blocks.
+ * When one more would be needed, the blocks with the largest hash are
+ * dropped and T is lowered to that hash (fixed-size SHARDS); the
+ * histogram collected so far is rescaled to the new rate.  The final
+ * histogram is corrected so that its total matches the expected number
+ * of sampled references (SHARDS_adj).
+ *
+ * Scaled distances are multiples of 1 / R lines, so the curve is only
+ * reported at that resolution.  Sampling pays off for caches that are
+ * large compared to 1 / R lines per set, typically with s = 0.
+ *
+ * Error estimates come from random groups: the sampled blocks are
+ * split into SHARDS_GROUPS groups by other bits of the hash, a curve is
+ * computed for each group, and the spread of the group curves gives
+ * the standard error of the full curve.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "csim.h"
+#include "stackdist.h"
+
+#define SHARDS_MODULUS (1 << 24)
+#define SHARDS_GROUPS 8
+
+/* Type: A sampled block in the max-heap ordered by hash */
+typedef struct shards_entry {
+    unsigned int hash;
+    mem_addr_t addr;
+} shards_entry_t;
+
+/* Type: Sampling state */
+typedef struct shards {
+    stack_dist_t sd;
+    unsigned int threshold;   /* sample blocks whose hash is below it */
+    shards_entry_t* heap;     /* tracked blocks, largest hash on top */
+    int count;
+    int max_blocks;
+    int max_E;
+    /* weighted histograms of scaled distances per group: bucket d for
+       d < max_E, max_E for longer distances, max_E + 1 for cold */
+    double* histogram[SHARDS_GROUPS];
+    unsigned long long int sampled;
+} shards_t;
+
+/*
+ * hashBlock - Mix the bits of a block number (splitmix64 finalizer)
+ */
+static inline unsigned long long hashBlock(mem_addr_t block)
+{
+    block ^= block >> 30;
+    block *= 0xbf58476d1ce4e5b9ULL;
+    block ^= block >> 27;
+    block *= 0x94d049bb133111ebULL;
+    return block ^ (block >> 31);
+}
+
+/*
+ * heapPush - Track a newly sampled block
+ */
+static void heapPush(shards_t* sh, unsigned int hash, mem_addr_t addr)
+{
+    int i = sh->count++;
+
+    while (i > 0 && sh->heap[(i - 1) / 2].hash < hash) {
+        sh->heap[i] = sh->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sh->heap[i].hash = hash;
+    sh->heap[i].addr = addr;
+}
+
+/*
+ * heapPop - Stop tracking the block with the largest hash
+ */
+static shards_entry_t heapPop(shards_t* sh)
+{
+    shards_entry_t top = sh->heap[0];
+    shards_entry_t last = sh->heap[--sh->count];
+    int i = 0;
+
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= sh->count)
+            break;
+        if (child + 1 < sh->count &&
+            sh->heap[child + 1].hash > sh->heap[child].hash)
+            child++;
+        if (sh->heap[child].hash <= last.hash)
+            break;
+        sh->heap[i] = sh->heap[child];
+        i = child;
+    }
+    if (sh->count > 0)
+        sh->heap[i] = last;
+    return top;
+}
+
+/*
+ * lowerThreshold - Drop the blocks with the largest hash, lower the
+ *     sampling rate to match, and rescale what has been counted so far
+ */
+static void lowerThreshold(shards_t* sh)
+{
+    unsigned int old = sh->threshold;
+    unsigned int hash = sh->heap[0].hash;
+    double scale;
+
+    while (sh->count > 0 && sh->heap[0].hash == hash)
+        forgetBlock(&sh->sd, heapPop(sh).addr);
+    sh->threshold = hash;
+
+    scale = (double)sh->threshold / old;
+    for (int g = 0; g < SHARDS_GROUPS; g++)
+        for (int d = 0; d <= sh->max_E + 1; d++)
+            sh->histogram[g][d] *= scale;
+}
+
+/*
+ * sampleAccess - Feed one data access through the sampling filter
+ */
+static void sampleAccess(shards_t* sh, mem_addr_t addr)
+{
+    unsigned long long hash = hashBlock(addr >> sh->sd.b);
+    unsigned int h = hash & (SHARDS_MODULUS - 1);
+    int group = (hash >> 32) % SHARDS_GROUPS;
+    long long d;
+
+    if (h >= sh->threshold)
+        return;
+
+    sh->sampled++;
+    d = stackDistance(&sh->sd, addr);
+    if (d < 0) {
+        sh->histogram[group][sh->max_E + 1] += 1;
+        heapPush(sh, h, addr);
+        if (sh->count > sh->max_blocks)
+            lowerThreshold(sh);
+        return;
+    }
+
+    /* scale the distance among sampled blocks up to the full trace */
+    d = (long long)(d * (double)SHARDS_MODULUS / sh->threshold);
+    sh->histogram[group][d < sh->max_E ? d : sh->max_E] += 1;
+}
+
+/*
+ * missRatios - Turn a histogram into miss ratios for E = 1..max_E
+ */
+static void missRatios(const double* histogram, int max_E, double* ratios)
+{
+    double total = 0, hits = 0;
+
+    for (int d = 0; d <= max_E + 1; d++)
+        total += histogram[d];
+    for (int E = 1; E <= max_E; E++) {
+        hits += histogram[E - 1];
+        ratios[E - 1] = total > 0 ? 1 - hits / total : 0;
+        /* the SHARDS_adj correction can push small caches past 1 */
+        if (ratios[E - 1] > 1)
+            ratios[E - 1] = 1;
+        if (ratios[E - 1] < 0)
+            ratios[E - 1] = 0;
+    }
+}
+
+/*
+ * runShards - Print an approximate miss-ratio curve for 2^s sets of
+ *     2^b byte blocks and E = 1..max_E, sampling at most max_blocks
+ *     blocks at an initial rate of rate
+ */
+int runShards(char* trace_fn, int s, int b, int max_E, double rate,
+              int max_blocks)
+{
+    trace_access_t batch[TRACE_BATCH];
+    unsigned long long int total = 0;
+    double* combined = NULL;
+    double* ratios = NULL;
+    double* group_ratios[SHARDS_GROUPS] = { NULL };
+    double expected, R;
+    int step, allocated, result = -1;
+    trace_reader_t* tr;
+    shards_t sh;
+    size_t n;
+
+    if (max_E < 1 || rate <= 0 || rate > 1 || max_blocks < 1) {
+        fprintf(stderr, "Bad sampling parameters\n");
+        return -1;
+    }
+    memset(&sh, 0, sizeof(shards_t));
+    if (initStackDist(&sh.sd, s, b) < 0) {
+        fprintf(stderr, "Cannot sample s=%d b=%d\n", s, b);
+        return -1;
+    }
+    sh.threshold = (unsigned int)(rate * SHARDS_MODULUS);
+    if (sh.threshold == 0)
+        sh.threshold = 1;
+    sh.max_blocks = max_blocks;
+    sh.max_E = max_E;
+    /* per-E arrays live on the heap: max_E is large for s = 0 */
+    sh.heap = malloc((max_blocks + 1) * sizeof(shards_entry_t));
+    combined = calloc(max_E + 2, sizeof(double));
+    ratios = calloc(max_E, sizeof(double));
+    allocated = sh.heap && combined && ratios;
+    for (int g = 0; g < SHARDS_GROUPS; g++) {
+        sh.histogram[g] = calloc(max_E + 2, sizeof(double));
+        group_ratios[g] = calloc(max_E, sizeof(double));
+        allocated = allocated && sh.histogram[g] && group_ratios[g];
+    }
+    if (!allocated) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+
+    tr = traceOpen(trace_fn);
+    if (!tr)
+        goto done;
+    traceStartReadAhead(tr);
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            /* same access semantics as accessTrace() */
+            if (batch[i].op == 'I')
+                continue;
+            sampleAccess(&sh, batch[i].addr);
+            total++;
+            if (batch[i].op == 'M') {
+                sampleAccess(&sh, batch[i].addr);
+                total++;
+            }
+        }
+    }
+    traceClose(tr);
+
+    /* SHARDS_adj: move the shortfall between the expected and the
+       actual number of sampled references into the first bucket */
+    R = (double)sh.threshold / SHARDS_MODULUS;
+    expected = total * R;
+    for (int g = 0; g < SHARDS_GROUPS; g++)
+        for (int d = 0; d <= max_E + 1; d++) {
+            combined[d] += sh.histogram[g][d];
+            expected -= sh.histogram[g][d];
+        }
+    combined[0] += expected;
+    missRatios(combined, max_E, ratios);
+    for (int g = 0; g < SHARDS_GROUPS; g++)
+        missRatios(sh.histogram[g], max_E, group_ratios[g]);
+
+    printf("rate:%.6f tracked_blocks:%d sampled:%llu references:%llu\n",
+           R, sh.count, sh.sampled, total);
+    /* scaled distances are multiples of 1 / R, so finer steps in E
+       carry no information */
+    step = (int)(1 / R);
+    if (step < 1)
+        step = 1;
+    for (int E = step < max_E ? step : max_E; ; E += step) {
+        double mean = 0, var = 0, err;
+
+        if (E > max_E)
+            E = max_E;
+        for (int g = 0; g < SHARDS_GROUPS; g++)
+            mean += group_ratios[g][E - 1] / SHARDS_GROUPS;
+        for (int g = 0; g < SHARDS_GROUPS; g++)
+            var += (group_ratios[g][E - 1] - mean) *
+                   (group_ratios[g][E - 1] - mean);
+        /* standard error of the mean of the groups with the finite
+           population correction for sampling a fraction R, 95% interval */
+        err = 1.96 * sqrt(var / (SHARDS_GROUPS - 1) / SHARDS_GROUPS * (1 - R));
+        printf("E:%d miss_ratio:%.4f error:%.4f misses:%.0f\n",
+               E, ratios[E - 1], err, ratios[E - 1] * total);
+        if (E == max_E)
+            break;
+    }
+
+    result = 0;
+
+done:
+    for (int g = 0; g < SHARDS_GROUPS; g++) {
+        free(sh.histogram[g]);
+        free(group_ratios[g]);
+    }
+    free(combined);
+    free(ratios);
+    free(sh.heap);
+    freeStackDist(&sh.sd);
+    return result;
+}
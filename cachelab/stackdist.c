@@ -0,0 +1,179 @@
+/*
+ * stackdist.c - LRU stack distances per cache set, see stackdist.h
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "stackdist.h"
+
+#define SD_MIN_CAPACITY 8
+
+/*
+ * fenwickAdd - Add delta at timestamp t
+ */
+static inline void fenwickAdd(sd_set_t* set, unsigned int t, int delta)
+{
+    for (; t <= set->capacity; t += t & -t)
+        set->tree[t] += delta;
+}
+
+/*
+ * fenwickPrefix - Number of marked timestamps in 1..t
+ */
+static inline unsigned int fenwickPrefix(const sd_set_t* set, unsigned int t)
+{
+    unsigned int sum = 0;
+
+    for (; t > 0; t -= t & -t)
+        sum += set->tree[t];
+    return sum;
+}
+
+/*
+ * compact - Renumber the marked timestamps of a set as 1..live,
+ *     doubling the capacity first if more than half of it is live.
+ *     Returns 0 on success.
+ */
+static int compact(stack_dist_t* sd, sd_set_t* set)
+{
+    unsigned int capacity = set->capacity;
+    unsigned int* tree;
+    mem_addr_t* blocks;
+    unsigned char* marked;
+    unsigned int t, next = 0;
+
+    if (capacity < SD_MIN_CAPACITY)
+        capacity = SD_MIN_CAPACITY;
+    else if (set->live * 2 >= capacity)
+        capacity *= 2;
+
+    tree = calloc(capacity + 1, sizeof(unsigned int));
+    blocks = malloc((capacity + 1) * sizeof(mem_addr_t));
+    marked = calloc(capacity + 1, 1);
+    if (!tree || !blocks || !marked) {
+        free(tree);
+        free(blocks);
+        free(marked);
+        return -1;
+    }
+
+    for (t = 1; t <= set->now; t++) {
+        if (!set->marked[t])
+            continue;
+        next++;
+        blocks[next] = set->blocks[t];
+        marked[next] = 1;
+        *blockmapFind(&sd->last_use, set->blocks[t]) = next;
+    }
+
+    /* build the Fenwick tree in linear time */
+    for (t = 1; t <= capacity; t++) {
+        unsigned int parent = t + (t & -t);
+        tree[t] += marked[t];
+        if (parent <= capacity)
+            tree[parent] += tree[t];
+    }
+
+    free(set->tree);
+    free(set->blocks);
+    free(set->marked);
+    set->tree = tree;
+    set->blocks = blocks;
+    set->marked = marked;
+    set->capacity = capacity;
+    set->now = next;
+    return 0;
+}
+
+/*
+ * initStackDist - Set up an engine with no history
+ */
+int initStackDist(stack_dist_t* sd, int s, int b)
+{
+    if (s < 0 || b < 0 || s + b > 63 || s > 30)
+        return -1;
+
+    memset(sd, 0, sizeof(stack_dist_t));
+    sd->s = s;
+    sd->b = b;
+    sd->set_index_mask = (1ULL << s) - 1;
+    sd->sets = calloc(1ULL << s, sizeof(sd_set_t));
+    if (!sd->sets || initBlockmap(&sd->last_use) < 0) {
+        free(sd->sets);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * freeStackDist - free allocated memory
+ */
+void freeStackDist(stack_dist_t* sd)
+{
+    mem_addr_t i;
+
+    for (i = 0; i <= sd->set_index_mask; i++) {
+        free(sd->sets[i].tree);
+        free(sd->sets[i].blocks);
+        free(sd->sets[i].marked);
+    }
+    free(sd->sets);
+    freeBlockmap(&sd->last_use);
+    sd->sets = NULL;
+}
+
+/*
+ * stackDistance - Record an access to addr and return its stack distance
+ */
+long long stackDistance(stack_dist_t* sd, mem_addr_t addr)
+{
+    mem_addr_t block = addr >> sd->b;
+    sd_set_t* set = &sd->sets[block & sd->set_index_mask];
+    unsigned long long int* last;
+    long long distance = -1;
+    int created;
+
+    if (set->now == set->capacity && compact(sd, set) < 0) {
+        fprintf(stderr, "Out of memory tracking stack distances\n");
+        exit(1);
+    }
+
+    last = blockmapInsert(&sd->last_use, block, &created);
+    if (!last) {
+        fprintf(stderr, "Out of memory tracking stack distances\n");
+        exit(1);
+    }
+    if (created) {
+        set->live++;
+    } else {
+        /* every marked timestamp after the previous use is a distinct
+           block touched since */
+        distance = set->live - fenwickPrefix(set, (unsigned int)*last);
+        fenwickAdd(set, (unsigned int)*last, -1);
+        set->marked[*last] = 0;
+    }
+
+    set->now++;
+    fenwickAdd(set, set->now, 1);
+    set->blocks[set->now] = block;
+    set->marked[set->now] = 1;
+    *last = set->now;
+    return distance;
+}
+
+/*
+ * forgetBlock - Drop the block containing addr from the history
+ */
+void forgetBlock(stack_dist_t* sd, mem_addr_t addr)
+{
+    mem_addr_t block = addr >> sd->b;
+    sd_set_t* set = &sd->sets[block & sd->set_index_mask];
+    unsigned long long int* last = blockmapFind(&sd->last_use, block);
+
+    if (!last)
+        return;
+    fenwickAdd(set, (unsigned int)*last, -1);
+    set->marked[*last] = 0;
+    set->live--;
+    blockmapRemove(&sd->last_use, block);
+}
@@ -0,0 +1,56 @@
+/*
+ * stackdist.h - LRU stack distances per cache set
+ *
+ * The stack distance of an access is the number of distinct other
+ * blocks of the same set touched since the previous access to its
+ * block.  An LRU cache with E lines per set hits exactly the accesses
+ * whose distance is below E, so one pass over a trace yields the hit
+ * and miss counts for every associativity at once.
+ *
+ * Each set numbers its accesses with timestamps and keeps a Fenwick
+ * tree with a 1 at the timestamp of the latest access to every block.
+ * The distance is then the number of 1s after the block's previous
+ * timestamp, which takes O(log n) to count.  Timestamps are compacted
+ * whenever they run out, so a set needs memory proportional to the
+ * number of distinct blocks it has seen, not the number of accesses.
+ */
+#ifndef CSIM_STACKDIST_H
+#define CSIM_STACKDIST_H
+
+#include "blockmap.h"
+
+/* Type: Recency state of one cache set */
+typedef struct sd_set {
+    unsigned int* tree;     /* Fenwick tree over timestamps 1..capacity */
+    mem_addr_t* blocks;     /* block accessed at each timestamp */
+    unsigned char* marked;  /* timestamp is the latest use of its block */
+    unsigned int capacity;
+    unsigned int now;       /* last timestamp handed out */
+    unsigned int live;      /* distinct blocks currently tracked */
+} sd_set_t;
+
+/* Type: Stack distance engine for 2^s sets of 2^b byte blocks */
+typedef struct stack_dist {
+    int s;
+    int b;
+    mem_addr_t set_index_mask;
+    sd_set_t* sets;
+    blockmap_t last_use;    /* block -> timestamp of its latest access */
+} stack_dist_t;
+
+/* initStackDist - Set up an engine with no history. Returns 0 on success */
+int initStackDist(stack_dist_t* sd, int s, int b);
+
+/* freeStackDist - free allocated memory */
+void freeStackDist(stack_dist_t* sd);
+
+/*
+ * stackDistance - Record an access to addr and return its stack
+ *     distance, or -1 if its block was never seen before.
+ */
+long long stackDistance(stack_dist_t* sd, mem_addr_t addr);
+
+/* forgetBlock - Drop the block containing addr from the history */
+void forgetBlock(stack_dist_t* sd, mem_addr_t addr);
+
+#endif /* CSIM_STACKDIST_H */
@@ -0,0 +1,96 @@
+/*
+ * stackrun.c - The csim mode that turns the LRU stack distances of a
+ *     trace into hit and miss counts for every associativity
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include "csim.h"
+#include "stackdist.h"
+
+/*
+ * runStackDist - Print the stack distance histogram of a trace and
+ *     the LRU hits, misses and evictions for E = 1..max_E
+ */
+int runStackDist(char* trace_fn, int s, int b, int max_E)
+{
+    trace_access_t batch[TRACE_BATCH];
+    unsigned long long int* histogram;
+    unsigned long long int* sets_with;
+    unsigned long long int cold = 0, total = 0, hits = 0, fills = 0;
+    unsigned long long int evictions;
+    trace_reader_t* tr;
+    stack_dist_t sd;
+    mem_addr_t i;
+    size_t n;
+    int E;
+
+    if (max_E < 1 || initStackDist(&sd, s, b) < 0) {
+        fprintf(stderr, "Cannot compute stack distances for s=%d b=%d E<=%d\n",
+                s, b, max_E);
+        return -1;
+    }
+    /* histogram[max_E] collects every distance of max_E or more */
+    histogram = calloc(max_E + 1, sizeof(unsigned long long int));
+    sets_with = calloc(max_E, sizeof(unsigned long long int));
+    if (!histogram || !sets_with) {
+        fprintf(stderr, "Out of memory\n");
+        goto fail;
+    }
+    tr = traceOpen(trace_fn);
+    if (!tr)
+        goto fail;
+    traceStartReadAhead(tr);
+
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        for (size_t k = 0; k < n; k++) {
+            long long d;
+
+            /* same access semantics as accessTrace() */
+            if (batch[k].op == 'I')
+                continue;
+            d = stackDistance(&sd, batch[k].addr);
+            if (d < 0)
+                cold++;
+            else
+                histogram[d < max_E ? d : max_E]++;
+            total++;
+            if (batch[k].op == 'M') {
+                stackDistance(&sd, batch[k].addr);
+                histogram[0]++;
+                total++;
+            }
+        }
+    }
+    traceClose(tr);
+
+    /* sets_with[k] counts the sets holding more than k distinct blocks,
+       which is how many sets fill their (k+1)th line without evicting */
+    for (i = 0; i <= sd.set_index_mask; i++)
+        for (E = 0; E < max_E && (unsigned int)E < sd.sets[i].live; E++)
+            sets_with[E]++;
+
+    printf("distance:cold count:%llu\n", cold);
+    for (E = 0; E < max_E; E++)
+        printf("distance:%d count:%llu\n", E, histogram[E]);
+    printf("distance:>=%d count:%llu\n", max_E, histogram[max_E]);
+
+    for (E = 1; E <= max_E; E++) {
+        hits += histogram[E - 1];
+        fills += sets_with[E - 1];
+        /* every miss that does not fill an empty line evicts one */
+        evictions = (total - hits) - fills;
+        printf("E:%d hits:%llu misses:%llu evictions:%llu\n",
+               E, hits, total - hits, evictions);
+    }
+
+    free(sets_with);
+    free(histogram);
+    freeStackDist(&sd);
+    return 0;
+
+fail:
+    free(sets_with);
+    free(histogram);
+    freeStackDist(&sd);
+    return -1;
+}
@@ -0,0 +1,278 @@
+/*
+ * sweep.c - Single-pass design-space sweeps
+ *
+ * The trace is parsed once by the main thread into batches of decoded
+ * accesses.  Every configured cache is owned by exactly one worker
+ * thread, and each worker replays each batch against all of its
+ * caches.  Two batch buffers let the main thread decode the next batch
+ * while the workers simulate the current one.
+ *
+ * Geometries are given as a comma separated list of s:E:b triples.
+ * Each field is a number, a range lo-hi, or several of those joined
+ * with '/', and a triple stands for every combination of its fields:
+ *
+ *     4-8:1/2/4/8:5      s = 4..8, E = 1, 2, 4 or 8, b = 5 (20 caches)
+ *     5:1:5,10:16:6      two caches
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "csim.h"
+
+#define MAX_FIELD_VALUES 64
+
+/* Type: The caches simulated by one worker thread */
+typedef struct sweep_worker {
+    pthread_t thread;
+    cache_t** caches;
+    int ncaches;
+    unsigned long long int load; /* estimated cost per access */
+} sweep_worker_t;
+
+/* Batches shared between the main thread and the workers */
+static trace_access_t batches[2][TRACE_BATCH];
+static size_t batch_len[2];
+static pthread_barrier_t batch_barrier;
+
+/*
+ * parseField - Expand one field of a geometry into values.  Returns
+ *     the number of values or -1 on a syntax error.
+ */
+static int parseField(char* field, int values[MAX_FIELD_VALUES])
+{
+    int n = 0;
+    char* save = NULL;
+    char* item;
+
+    for (item = strtok_r(field, "/", &save); item;
+         item = strtok_r(NULL, "/", &save)) {
+        char* end;
+        long lo = strtol(item, &end, 10);
+        long hi = lo;
+
+        if (end == item)
+            return -1;
+        if (*end == '-') {
+            char* start = end + 1;
+            hi = strtol(start, &end, 10);
+            if (end == start)
+                return -1;
+        }
+        if (*end != '\0' || lo < 0 || hi < lo)
+            return -1;
+        for (; lo <= hi; lo++) {
+            if (n == MAX_FIELD_VALUES)
+                return -1;
+            values[n++] = (int)lo;
+        }
+    }
+    return n;
+}
+
+/*
+ * parseSpec - Create a cache for every geometry in spec.  Returns the
+ *     number of caches or -1 after printing an error.
+ */
+static int parseSpec(char* spec, const cache_policy_t* policy,
+                     cache_t** caches_out)
+{
+    cache_t* caches = NULL;
+    int ncaches = 0;
+    char* copy = strdup(spec);
+    char* save = NULL;
+    char* geom;
+
+    if (!copy) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    for (geom = strtok_r(copy, ",", &save); geom;
+         geom = strtok_r(NULL, ",", &save)) {
+        int sv[MAX_FIELD_VALUES], Ev[MAX_FIELD_VALUES], bv[MAX_FIELD_VALUES];
+        int ns, nE, nb;
+        cache_t* grown;
+        char* fields[3];
+        char* colon;
+        int i, j, k;
+
+        fields[0] = geom;
+        for (i = 1; i < 3; i++) {
+            colon = strchr(fields[i - 1], ':');
+            if (!colon)
+                goto bad;
+            *colon = '\0';
+            fields[i] = colon + 1;
+        }
+        if (strchr(fields[2], ':'))
+            goto bad;
+        ns = parseField(fields[0], sv);
+        nE = parseField(fields[1], Ev);
+        nb = parseField(fields[2], bv);
+        if (ns <= 0 || nE <= 0 || nb <= 0)
+            goto bad;
+
+        grown = realloc(caches, (ncaches + ns * nE * nb) * sizeof(cache_t));
+        if (!grown) {
+            fprintf(stderr, "Out of memory\n");
+            goto fail;
+        }
+        caches = grown;
+        for (i = 0; i < ns; i++)
+            for (j = 0; j < nE; j++)
+                for (k = 0; k < nb; k++) {
+                    if (initCache(&caches[ncaches], sv[i], Ev[j], bv[k],
+                                  policy) < 0) {
+                        fprintf(stderr, "Cannot simulate s=%d E=%d b=%d\n",
+                                sv[i], Ev[j], bv[k]);
+                        goto fail;
+                    }
+                    ncaches++;
+                }
+    }
+    free(copy);
+    *caches_out = caches;
+    return ncaches;
+
+bad:
+    fprintf(stderr, "Bad cache geometry list: %s\n", spec);
+fail:
+    while (ncaches > 0)
+        freeCache(&caches[--ncaches]);
+    free(caches);
+    free(copy);
+    return -1;
+}
+
+/*
+ * compareCost - Order caches by decreasing associativity
+ */
+static int compareCost(const void* a, const void* b)
+{
+    const cache_t* ca = *(cache_t* const*)a;
+    const cache_t* cb = *(cache_t* const*)b;
+    return cb->E - ca->E;
+}
+
+/*
+ * sweepWorker - Replay every batch against the caches of one worker
+ */
+static void* sweepWorker(void* arg)
+{
+    sweep_worker_t* worker = arg;
+    int cur = 0;
+
+    for (;;) {
+        /* wait for the main thread to publish batch cur */
+        pthread_barrier_wait(&batch_barrier);
+        if (batch_len[cur] == 0)
+            break;
+        for (int c = 0; c < worker->ncaches; c++)
+            accessBatch(worker->caches[c], batches[cur], batch_len[cur]);
+        /* tell the main thread batch cur may be overwritten */
+        pthread_barrier_wait(&batch_barrier);
+        cur ^= 1;
+    }
+    return NULL;
+}
+
+/*
+ * runSweep - Simulate every cache geometry in spec in one trace pass
+ */
+int runSweep(char* trace_fn, char* spec, int nthreads,
+             const cache_policy_t* policy)
+{
+    sweep_worker_t* workers;
+    trace_reader_t* tr;
+    cache_t** order;
+    cache_t* caches;
+    int ncaches, i, cur = 0;
+
+    ncaches = parseSpec(spec, policy, &caches);
+    if (ncaches < 0)
+        return -1;
+
+    tr = traceOpen(trace_fn);
+    if (!tr) {
+        for (i = 0; i < ncaches; i++)
+            freeCache(&caches[i]);
+        free(caches);
+        return -1;
+    }
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > ncaches)
+        nthreads = ncaches;
+    if (nthreads < 1)
+        nthreads = 1;
+
+    /* hand each cache to the least loaded worker, costliest first;
+       the cost of an access grows with the associativity */
+    order = malloc(ncaches * sizeof(cache_t*));
+    workers = calloc(nthreads, sizeof(sweep_worker_t));
+    for (i = 0; workers && i < nthreads; i++) {
+        workers[i].caches = malloc(ncaches * sizeof(cache_t*));
+        if (!workers[i].caches)
+            break;
+    }
+    if (!order || !workers || i < nthreads) {
+        fprintf(stderr, "Out of memory\n");
+        for (i = 0; workers && i < nthreads; i++)
+            free(workers[i].caches);
+        free(workers);
+        free(order);
+        traceClose(tr);
+        for (i = 0; i < ncaches; i++)
+            freeCache(&caches[i]);
+        free(caches);
+        return -1;
+    }
+    for (i = 0; i < ncaches; i++)
+        order[i] = &caches[i];
+    qsort(order, ncaches, sizeof(cache_t*), compareCost);
+    for (i = 0; i < ncaches; i++) {
+        int w = 0;
+        for (int k = 1; k < nthreads; k++)
+            if (workers[k].load < workers[w].load)
+                w = k;
+        workers[w].caches[workers[w].ncaches++] = order[i];
+        workers[w].load += order[i]->E;
+    }
+    free(order);
+
+    pthread_barrier_init(&batch_barrier, NULL, nthreads + 1);
+    for (i = 0; i < nthreads; i++)
+        pthread_create(&workers[i].thread, NULL, sweepWorker, &workers[i]);
+
+    batch_len[cur] = traceRead(tr, batches[cur], TRACE_BATCH);
+    for (;;) {
+        /* publish batch cur to the workers */
+        pthread_barrier_wait(&batch_barrier);
+        if (batch_len[cur] == 0)
+            break;
+        /* decode the next batch while the workers simulate this one */
+        batch_len[cur ^ 1] = traceRead(tr, batches[cur ^ 1], TRACE_BATCH);
+        pthread_barrier_wait(&batch_barrier);
+        cur ^= 1;
+    }
+
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].caches);
+    }
+    pthread_barrier_destroy(&batch_barrier);
+    free(workers);
+    traceClose(tr);
+
+    for (i = 0; i < ncaches; i++) {
+        printf("s:%d E:%d b:%d hits:%llu misses:%llu evictions:%llu\n",
+               caches[i].s, caches[i].E, caches[i].b, caches[i].hit_count,
+               caches[i].miss_count, caches[i].eviction_count);
+        freeCache(&caches[i]);
+    }
+    free(caches);
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * timeshard.c - Parallel simulation of contiguous pieces of a trace
+ *
+ * The trace file is cut into chunks of about equal numbers of records
+ * by traceSplit(), which leaves the records undecoded.  Every chunk is
+ * simulated with its own cache_t, so the chunks run on separate
+ * threads, each decoding its own part of the file as it goes.  A chunk
+ * first replays the last warmup records before it to fill its cache
+ * and then clears the counters, so only its own records count.
+ *
+ * What warm-up cannot supply is the older history of the sets.  With
+ * write-allocate, a miss that evicts nothing filled a line that was
+ * still empty; after the first chunk such a line might have held the
+ * block in a sequential run.  These cold misses bound the error: under
+ * LRU the cache of a chunk holds a subset of the lines a sequential
+ * run would, and the two agree on every set that is full, so the true
+ * misses lie in [misses - cold, misses] and the true evictions in
+ * [evictions, evictions + cold].  Other policies, MRU among them, do
+ * not keep such a subset, so only LRU is simulated.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "cachelab.h"
+#include "csim.h"
+
+/* Type: One chunk of the trace and its cache */
+typedef struct time_shard {
+    trace_mark_t warmup; /* first warm-up record */
+    trace_mark_t start;  /* first record of the chunk */
+    trace_mark_t end;    /* first record after it */
+    cache_t cache;
+    int failed;          /* a part of the trace could not be read */
+} time_shard_t;
+
+/* Type: Chunks simulated by one worker thread */
+typedef struct shard_worker {
+    pthread_t thread;
+    char* trace_fn;
+    time_shard_t* shards;
+    int first, nshards, stride;
+} shard_worker_t;
+
+/*
+ * replayRange - Access cache with the records between two marks.
+ *     Returns 0 on success.
+ */
+static int replayRange(cache_t* cache, char* trace_fn,
+                       const trace_mark_t* from, const trace_mark_t* to)
+{
+    trace_access_t batch[TRACE_BATCH];
+    trace_reader_t* tr = traceOpenRange(trace_fn, from, to);
+    size_t n;
+
+    if (!tr)
+        return -1;
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0)
+        accessBatch(cache, batch, n);
+    traceClose(tr);
+    return 0;
+}
+
+/*
+ * shardWorker - Warm up and simulate every chunk of one worker
+ */
+static void* shardWorker(void* arg)
+{
+    shard_worker_t* worker = arg;
+
+    for (int i = worker->first; i < worker->nshards; i += worker->stride) {
+        time_shard_t* shard = &worker->shards[i];
+        cache_t* cache = &shard->cache;
+
+        if (replayRange(cache, worker->trace_fn, &shard->warmup,
+                        &shard->start) < 0) {
+            shard->failed = 1;
+            continue;
+        }
+        resetCounters(cache);
+        if (replayRange(cache, worker->trace_fn, &shard->start,
+                        &shard->end) < 0)
+            shard->failed = 1;
+    }
+    return NULL;
+}
+
+/*
+ * runTimeShards - Simulate chunks of the trace in parallel and merge
+ */
+int runTimeShards(char* trace_fn, int s, int E, int b,
+                  const cache_policy_t* policy, int nchunks,
+                  long long warmup, int nthreads)
+{
+    unsigned long long int hits = 0, misses = 0, evictions = 0, cold = 0;
+    trace_mark_t* warmups;
+    trace_mark_t* starts;
+    time_shard_t* shards;
+    shard_worker_t* workers;
+    int i, failed = 0;
+
+    if (nchunks < 1) {
+        fprintf(stderr, "The number of chunks must be positive\n");
+        return -1;
+    }
+    if (!policy || strcmp(policy->name, "lru") != 0) {
+        fprintf(stderr, "Chunks are only bounded under lru, use -p lru\n");
+        return -1;
+    }
+    shards = calloc(nchunks, sizeof(time_shard_t));
+    if (!shards) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    for (i = 0; i < nchunks; i++) {
+        if (initCache(&shards[i].cache, s, E, b, policy) < 0) {
+            fprintf(stderr, "Cannot simulate s=%d E=%d b=%d\n", s, E, b);
+            while (i-- > 0)
+                freeCache(&shards[i].cache);
+            free(shards);
+            return -1;
+        }
+    }
+    /* by default warm up with four times as many records as lines */
+    if (warmup < 0)
+        warmup = 4LL * shards[0].cache.S * E;
+
+    warmups = malloc(nchunks * sizeof(trace_mark_t));
+    starts = malloc((nchunks + 1) * sizeof(trace_mark_t));
+    if (!warmups || !starts)
+        fprintf(stderr, "Out of memory\n");
+    if (!warmups || !starts ||
+        traceSplit(trace_fn, nchunks, warmup, warmups, starts) < 0) {
+        free(warmups);
+        free(starts);
+        for (i = 0; i < nchunks; i++)
+            freeCache(&shards[i].cache);
+        free(shards);
+        return -1;
+    }
+    for (i = 0; i < nchunks; i++) {
+        shards[i].warmup = warmups[i];
+        shards[i].start = starts[i];
+        shards[i].end = starts[i + 1];
+    }
+    free(warmups);
+    free(starts);
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > nchunks)
+        nthreads = nchunks;
+    if (nthreads < 1)
+        nthreads = 1;
+    workers = calloc(nthreads, sizeof(shard_worker_t));
+    if (!workers) {
+        fprintf(stderr, "Out of memory\n");
+        for (i = 0; i < nchunks; i++)
+            freeCache(&shards[i].cache);
+        free(shards);
+        return -1;
+    }
+    for (i = 0; i < nthreads; i++) {
+        workers[i].trace_fn = trace_fn;
+        workers[i].shards = shards;
+        workers[i].first = i;
+        workers[i].nshards = nchunks;
+        workers[i].stride = nthreads;
+        pthread_create(&workers[i].thread, NULL, shardWorker, &workers[i]);
+    }
+    for (i = 0; i < nthreads; i++)
+        pthread_join(workers[i].thread, NULL);
+    free(workers);
+
+    for (i = 0; i < nchunks; i++) {
+        cache_t* cache = &shards[i].cache;
+
+        hits += cache->hit_count;
+        misses += cache->miss_count;
+        evictions += cache->eviction_count;
+        if (i > 0)
+            cold += cache->miss_count - cache->eviction_count;
+        failed |= shards[i].failed;
+        freeCache(cache);
+    }
+    free(shards);
+    if (failed)
+        return -1;
+
+    printSummary((int)hits, (int)misses, (int)evictions);
+    printf("chunks:%d warmup:%lld cold_misses:%llu misses:[%llu,%llu] "
+           "evictions:[%llu,%llu]\n", nchunks, warmup, cold, misses - cold,
+           misses, evictions, evictions + cold);
+    return 0;
+}
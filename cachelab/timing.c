@@ -0,0 +1,207 @@
+/*
+ * timing.c - Timing layer over the hit and miss decisions, see timing.h
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "timing.h"
+
+/* L1, L2, L3, LLC and one more level; memory takes 200 */
+static const int default_latency[TIMING_MAX_LEVELS - 1] = {
+    4, 12, 40, 60, 60
+};
+
+/*
+ * parseLatencies - Parse "a:b:..." into the latencies of nlevels
+ *     levels and memory.  Returns 0 on success.
+ */
+static int parseLatencies(timing_t* t, char* value)
+{
+    char* save = NULL;
+    char* item;
+    int n = 0;
+
+    for (item = strtok_r(value, ":", &save); item;
+         item = strtok_r(NULL, ":", &save)) {
+        char* end;
+        long latency = strtol(item, &end, 10);
+
+        if (end == item || *end != '\0' || latency < 0 ||
+            n == t->nlatencies)
+            return -1;
+        t->latency[n++] = (int)latency;
+    }
+    return n == t->nlatencies ? 0 : -1;
+}
+
+/*
+ * initTiming - Parse spec and set up the timing state
+ */
+int initTiming(timing_t* t, const char* spec, int nlevels, int b)
+{
+    char* copy = strdup(spec);
+    char* save = NULL;
+    char* entry;
+    int i;
+
+    memset(t, 0, sizeof(timing_t));
+    if (nlevels + 1 > TIMING_MAX_LEVELS) {
+        fprintf(stderr, "Timing supports at most %d cache levels\n",
+                TIMING_MAX_LEVELS - 1);
+        free(copy);
+        return -1;
+    }
+    t->nlatencies = nlevels + 1;
+    for (i = 0; i < nlevels; i++)
+        t->latency[i] = default_latency[i];
+    t->latency[nlevels] = 200;
+    t->nmshrs = 8;
+    t->b = b;
+
+    for (entry = strtok_r(copy, " \t\n,", &save); entry;
+         entry = strtok_r(NULL, " \t\n,", &save)) {
+        char* eq = strchr(entry, '=');
+        char* end = NULL;
+
+        if (!eq)
+            goto bad;
+        *eq = '\0';
+        if (strcmp(entry, "lat") == 0) {
+            if (parseLatencies(t, eq + 1) < 0) {
+                fprintf(stderr, "Give %d latencies: one per level and one "
+                        "for memory\n", t->nlatencies);
+                free(copy);
+                return -1;
+            }
+        } else if (strcmp(entry, "mshrs") == 0) {
+            t->nmshrs = (int)strtol(eq + 1, &end, 10);
+            if (*end != '\0' || t->nmshrs < 1)
+                goto bad;
+        } else if (strcmp(entry, "bw") == 0) {
+            t->bandwidth = strtod(eq + 1, &end);
+            if (*end != '\0' || t->bandwidth <= 0)
+                goto bad;
+        } else {
+            goto bad;
+        }
+    }
+    free(copy);
+
+    t->mshrs = calloc(t->nmshrs, sizeof(mshr_t));
+    if (!t->mshrs) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    return 0;
+
+bad:
+    fprintf(stderr, "Bad timing spec: %s\n", spec);
+    free(copy);
+    return -1;
+}
+
+/*
+ * freeTiming - free allocated memory
+ */
+void freeTiming(timing_t* t)
+{
+    free(t->mshrs);
+    t->mshrs = NULL;
+}
+
+/*
+ * timingAccess - Issue one access and work out when it completes
+ */
+void timingAccess(timing_t* t, mem_addr_t addr, int level, int miss,
+                  unsigned long long int writeback_bytes)
+{
+    mem_addr_t block = addr >> t->b;
+    unsigned long long int arrival = t->now, issue = t->now, done;
+    int i;
+
+    if (level >= t->nlatencies)
+        level = t->nlatencies - 1;
+    if (!miss) {
+        /* bytes written below still occupy the link */
+        if (t->bandwidth > 0 && writeback_bytes > 0) {
+            double start = t->bus_free > issue ? t->bus_free : issue;
+            t->bus_free = start + writeback_bytes / t->bandwidth;
+        }
+        done = issue + t->latency[level];
+        for (i = 0; i < t->nmshrs; i++) {
+            if (t->mshrs[i].block == block && t->mshrs[i].done > done) {
+                done = t->mshrs[i].done;
+                t->merged++;
+                break;
+            }
+        }
+    } else {
+        /* take the register that frees first, waiting for it if busy */
+        mshr_t* mshr = &t->mshrs[0];
+        for (i = 1; i < t->nmshrs; i++)
+            if (t->mshrs[i].done < mshr->done)
+                mshr = &t->mshrs[i];
+        if (mshr->done > issue) {
+            t->stall_cycles += mshr->done - issue;
+            issue = mshr->done;
+        }
+        done = issue + t->latency[level];
+        if (t->bandwidth > 0) {
+            double start = t->bus_free > issue ? t->bus_free : issue;
+            t->bus_free = start + ((1ULL << t->b) + writeback_bytes) /
+                                  t->bandwidth;
+            if (done < (unsigned long long)ceil(t->bus_free))
+                done = (unsigned long long)ceil(t->bus_free);
+        }
+        mshr->block = block;
+        mshr->done = done;
+
+        /* misses issue in order, so their busy cycles form a union of
+           intervals sorted by start */
+        t->misses++;
+        t->miss_latency_sum += done - issue;
+        if (issue >= t->busy_until)
+            t->miss_busy += done - issue;
+        else if (done > t->busy_until)
+            t->miss_busy += done - t->busy_until;
+        if (done > t->busy_until)
+            t->busy_until = done;
+    }
+
+    t->accesses++;
+    t->latency_sum += done - arrival;
+    if (done > t->end)
+        t->end = done;
+    t->now = issue + 1;
+}
+
+/*
+ * timingRecord - Time the data accesses of one trace record
+ */
+void timingRecord(timing_t* t, const trace_access_t* access,
+                  unsigned long long int misses,
+                  unsigned long long int bytes_out)
+{
+    if (access->op == 'I')
+        return;
+    timingAccess(t, access->addr, misses > 0, misses > 0, bytes_out);
+    /* a modify is a load followed by a store */
+    if (access->op == 'M')
+        timingAccess(t, access->addr, misses > 1, misses > 1, 0);
+}
+
+/*
+ * printTiming - Print cycles, AMAT, MLP and the stalls
+ */
+void printTiming(const timing_t* t, FILE* fp)
+{
+    unsigned long long int cycles = t->end > t->now ? t->end : t->now;
+
+    fprintf(fp, "cycles:%llu amat:%.2f mlp:%.2f mshr_stall_cycles:%llu "
+            "merged_hits:%llu\n", cycles,
+            t->accesses ? (double)t->latency_sum / t->accesses : 0.0,
+            t->miss_busy ? (double)t->miss_latency_sum / t->miss_busy : 0.0,
+            t->stall_cycles, t->merged);
+}
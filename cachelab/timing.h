@@ -0,0 +1,97 @@
+/*
+ * timing.h - Estimated cycles, AMAT and memory-level parallelism
+ *
+ * The timing layer follows the hit and miss decisions of a cache, or
+ * of a cache hierarchy, access by access.  One access issues per
+ * cycle, in trace order, and completes after the latency of the level
+ * that served it; accesses do not wait for each other, so misses
+ * overlap as far as the hardware allows:
+ *
+ *   mshrs  A miss of the first level holds a miss status holding
+ *          register until its block arrives.  When all are busy the
+ *          issue stalls until one frees.  A hit on a block whose miss
+ *          is still outstanding completes when the block arrives.
+ *   bw     The link to the next level moves bw bytes per cycle.  Each
+ *          miss transfers a block over it, after the transfers issued
+ *          before it, and so do the bytes written to the next level:
+ *          dirty lines (or sectors) and write-through stores.  Only
+ *          misses wait for the link.
+ *
+ * AMAT is the average time from issue, including stalls, to
+ * completion.  MLP is the average number of outstanding misses over
+ * the cycles with at least one outstanding.
+ */
+#ifndef CSIM_TIMING_H
+#define CSIM_TIMING_H
+
+#include <stdio.h>
+#include "cache.h"
+
+#define TIMING_MAX_LEVELS 6
+
+/* Type: One miss status holding register */
+typedef struct mshr {
+    mem_addr_t block;
+    unsigned long long int done; /* cycle the block arrives */
+} mshr_t;
+
+/* Type: Timing state and counters */
+typedef struct timing {
+    int latency[TIMING_MAX_LEVELS]; /* per cache level, then memory */
+    int nlatencies;
+    int nmshrs;
+    double bandwidth;               /* bytes per cycle, 0 if unlimited */
+    int b;                          /* block offset bits */
+    mshr_t* mshrs;
+
+    unsigned long long int now;      /* issue cycle of the next access */
+    double bus_free;                 /* cycle the link becomes idle */
+    unsigned long long int end;      /* latest completion */
+    unsigned long long int busy_until; /* end of the current miss burst */
+
+    unsigned long long int accesses;
+    unsigned long long int latency_sum;
+    unsigned long long int misses;
+    unsigned long long int miss_latency_sum;
+    unsigned long long int miss_busy; /* cycles with a miss outstanding */
+    unsigned long long int stall_cycles;
+    unsigned long long int merged;    /* hits waiting for a pending miss */
+} timing_t;
+
+/*
+ * initTiming - Set up timing for nlevels cache levels of 2^b byte
+ *     blocks from a spec such as "lat=4:200,mshrs=8,bw=16".  lat
+ *     gives the latency of an access served by each level in order
+ *     and then by memory (default 4 for L1, 12 for L2, 40 for L3, 60
+ *     for the LLC and 200 for memory).  Split L1 caches are one level.
+ *     mshrs defaults to 8 and bw to unlimited.  Entries
+ *     are separated by commas or spaces.  Returns 0 on success or -1
+ *     after printing an error.
+ */
+int initTiming(timing_t* t, const char* spec, int nlevels, int b);
+
+/* freeTiming - free allocated memory */
+void freeTiming(timing_t* t);
+
+/*
+ * timingAccess - Time one access that was served by cache level
+ *     (nlevels for memory), a miss of the first level if miss is set.
+ *     The access also sent writeback_bytes to the next level.
+ */
+void timingAccess(timing_t* t, mem_addr_t addr, int level, int miss,
+                  unsigned long long int writeback_bytes);
+
+/*
+ * timingRecord - Time the data accesses of one trace record replayed
+ *     against a single cache, given the misses and the bytes sent to
+ *     the next level (bytes_to_next) the record caused there.  Its
+ *     first access takes the misses and the bytes.
+ */
+void timingRecord(timing_t* t, const trace_access_t* access,
+                  unsigned long long int misses,
+                  unsigned long long int bytes_out);
+
+/* printTiming - Print cycles, AMAT, MLP and the stalls */
+void printTiming(const timing_t* t, FILE* fp);
+
+#endif /* CSIM_TIMING_H */
@@ -0,0 +1,181 @@
+/*
+ * tlb.c - Translation lookaside buffers, see tlb.h
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tlb.h"
+
+static const char* level_names[TLB_MAX_LEVELS] = { "l1", "l2", "l3" };
+
+/*
+ * log2Exact - log2(n) if n is a power of two, else -1
+ */
+static int log2Exact(int n)
+{
+    int k = 0;
+
+    if (n < 1 || (n & (n - 1)))
+        return -1;
+    while ((1 << k) < n)
+        k++;
+    return k;
+}
+
+/*
+ * parseLevel - Parse "entries:ways" or "entries:ways:policy" and create
+ *     the level
+ */
+static int parseLevel(const char* name, const char* value, cache_t* cache,
+                      int page_bits)
+{
+    const cache_policy_t* policy = findPolicy("lru");
+    int entries, ways, used, s;
+
+    if (sscanf(value, "%d:%d%n", &entries, &ways, &used) != 2) {
+        fprintf(stderr, "Bad TLB level %s=%s\n", name, value);
+        return -1;
+    }
+    if (value[used] == ':') {
+        policy = findPolicy(value + used + 1);
+        if (!policy) {
+            fprintf(stderr, "Unknown replacement policy for %s: %s\n",
+                    name, value + used + 1);
+            return -1;
+        }
+    } else if (value[used] != '\0') {
+        fprintf(stderr, "Bad TLB level %s=%s\n", name, value);
+        return -1;
+    }
+    s = ways > 0 && entries % ways == 0 ? log2Exact(entries / ways) : -1;
+    if (s < 0) {
+        fprintf(stderr, "TLB %s: entries/ways must be a power of two\n", name);
+        return -1;
+    }
+    if (initCache(cache, s, ways, page_bits, policy) < 0) {
+        fprintf(stderr, "Cannot simulate TLB %s=%s\n", name, value);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * initTlb - Build a TLB from a spec
+ */
+int initTlb(tlb_t* tlb, const char* spec)
+{
+    char* values[TLB_MAX_LEVELS] = { NULL };
+    char* copy = strdup(spec);
+    char* save = NULL;
+    char* entry;
+    int i;
+
+    memset(tlb, 0, sizeof(tlb_t));
+    tlb->page_bits = 12;
+    tlb->walk_refs = 4;
+
+    for (entry = strtok_r(copy, " \t\r\n,", &save); entry;
+         entry = strtok_r(NULL, " \t\r\n,", &save)) {
+        char* eq = strchr(entry, '=');
+        if (!eq) {
+            fprintf(stderr, "Bad TLB entry: %s\n", entry);
+            goto fail;
+        }
+        *eq = '\0';
+        if (strcmp(entry, "page") == 0) {
+            if (strcmp(eq + 1, "4k") == 0) {
+                tlb->page_bits = 12;
+                tlb->walk_refs = 4;
+            } else if (strcmp(eq + 1, "2m") == 0) {
+                tlb->page_bits = 21;
+                tlb->walk_refs = 3;
+            } else if (strcmp(eq + 1, "1g") == 0) {
+                tlb->page_bits = 30;
+                tlb->walk_refs = 2;
+            } else {
+                fprintf(stderr, "Unknown page size: %s\n", eq + 1);
+                goto fail;
+            }
+            continue;
+        }
+        for (i = 0; i < TLB_MAX_LEVELS; i++)
+            if (strcmp(entry, level_names[i]) == 0)
+                break;
+        if (i == TLB_MAX_LEVELS) {
+            fprintf(stderr, "Unknown TLB level: %s\n", entry);
+            goto fail;
+        }
+        values[i] = eq + 1;
+    }
+
+    for (i = 0; i < TLB_MAX_LEVELS; i++) {
+        if (!values[i])
+            continue;
+        if (parseLevel(level_names[i], values[i],
+                       &tlb->levels[tlb->nlevels], tlb->page_bits) < 0)
+            goto fail;
+        tlb->names[tlb->nlevels++] = level_names[i];
+    }
+    if (tlb->nlevels == 0) {
+        fprintf(stderr, "The TLB needs at least one level\n");
+        goto fail;
+    }
+    free(copy);
+    return 0;
+
+fail:
+    freeTlb(tlb);
+    free(copy);
+    return -1;
+}
+
+/*
+ * freeTlb - free allocated memory
+ */
+void freeTlb(tlb_t* tlb)
+{
+    for (int i = 0; i < tlb->nlevels; i++)
+        freeCache(&tlb->levels[i]);
+    tlb->nlevels = 0;
+}
+
+/*
+ * translate - Look up the page of addr, filling the levels that missed
+ */
+int translate(tlb_t* tlb, mem_addr_t addr)
+{
+    for (int i = 0; i < tlb->nlevels; i++) {
+        unsigned long long int misses = tlb->levels[i].miss_count;
+
+        accessData(&tlb->levels[i], addr);
+        if (tlb->levels[i].miss_count == misses)
+            return i;
+    }
+    tlb->walks++;
+    return tlb->nlevels;
+}
+
+/*
+ * tlbAccessTrace - Translate the data address of one trace record
+ */
+void tlbAccessTrace(tlb_t* tlb, const trace_access_t* access)
+{
+    if (access->op == 'I')
+        return;
+    /* the store of a modify reuses the translation of its load */
+    translate(tlb, access->addr);
+}
+
+/*
+ * printTlb - Print the counters of every level and the page walks
+ */
+void printTlb(const tlb_t* tlb, FILE* fp)
+{
+    for (int i = 0; i < tlb->nlevels; i++)
+        fprintf(fp, "tlb %s hits:%llu misses:%llu evictions:%llu\n",
+                tlb->names[i], tlb->levels[i].hit_count,
+                tlb->levels[i].miss_count, tlb->levels[i].eviction_count);
+    fprintf(fp, "page walks:%llu walk references:%llu\n",
+            tlb->walks, tlb->walks * tlb->walk_refs);
+}
@@ -0,0 +1,57 @@
+/*
+ * tlb.h - Translation lookaside buffers and page walks
+ *
+ * A TLB level is a cache_t whose blocks are pages: a level of n
+ * entries and w ways is a cache of n/w sets of w lines of one page.
+ * Levels are looked up in order and a miss fills every level it
+ * passed, so a miss in the last level takes a page walk, which costs
+ * one memory reference per level of a four-level x86-64 page table:
+ * 4 for 4 KB pages, 3 for 2 MB pages and 2 for 1 GB pages.  Walk
+ * references are counted, not sent through the data cache.
+ */
+#ifndef CSIM_TLB_H
+#define CSIM_TLB_H
+
+#include <stdio.h>
+#include "cache.h"
+
+#define TLB_MAX_LEVELS 3
+
+/* Type: A multi-level TLB for one page size */
+typedef struct tlb {
+    const char* names[TLB_MAX_LEVELS]; /* "l1", "l2" or "l3" */
+    cache_t levels[TLB_MAX_LEVELS];
+    int nlevels;
+    int page_bits;  /* 12, 21 or 30 */
+    int walk_refs;  /* memory references per page walk */
+    unsigned long long int walks;
+} tlb_t;
+
+/*
+ * initTlb - Build a TLB from a spec such as "l1=64:4 l2=1536:12
+ *     page=4k".  Each level is given as entries:ways, optionally
+ *     followed by :policy (LRU otherwise), and the page size is 4k
+ *     (default), 2m or 1g.  Entries are separated by spaces or commas.
+ *     Returns 0 on success or -1 after printing an error.
+ */
+int initTlb(tlb_t* tlb, const char* spec);
+
+/* freeTlb - free allocated memory */
+void freeTlb(tlb_t* tlb);
+
+/*
+ * translate - Look up the page of addr.  Returns the index of the
+ *     level that hit, or nlevels if the translation took a page walk.
+ */
+int translate(tlb_t* tlb, mem_addr_t addr);
+
+/*
+ * tlbAccessTrace - Translate the data address of one trace record
+ *     once, a modify included: its store hits the entry its load used
+ */
+void tlbAccessTrace(tlb_t* tlb, const trace_access_t* access);
+
+/* printTlb - Print the counters of every level and the page walks */
+void printTlb(const tlb_t* tlb, FILE* fp);
+
+#endif /* CSIM_TLB_H */
@@ -0,0 +1,879 @@
+/*
+ * trace.c - Readers and writers for memory traces replayed by csim
+ *
+ * See trace.h for a description of the text and binary formats.
+ *
+ * Bytes come from a memory-mapped file, or through a buffer refilled
+ * from a pipe, from stdin, or from zlib when the trace is gzipped.
+ * A reader may also hand decoding to a read-ahead thread, which fills
+ * a ring of decoded batches while the caller simulates.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "trace.h"
+
+/* Size of the buffer used when a trace cannot be memory-mapped */
+#define TRACE_BUF_SIZE (1 << 16)
+/* Zeroed slack after the buffer so the hex decoder may over-read */
+#define TRACE_BUF_PAD 16
+/* Decoded batches the read-ahead thread may run ahead by */
+#define TRACE_RING_SLOTS 4
+
+/* Op codes stored in the low two bits of a binary record tag */
+static const char op_names[4] = { 'I', 'L', 'S', 'M' };
+
+/* Value of each hex digit, 0xff for every other character */
+static unsigned char hex_value[256];
+
+/* Type: One decoded batch of the read-ahead ring */
+typedef struct trace_slot {
+    trace_access_t accesses[TRACE_BATCH];
+    size_t len; /* 0 marks the end of the trace */
+} trace_slot_t;
+
+/* Type: Read-ahead thread and the ring it fills */
+typedef struct trace_ring {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    trace_slot_t slots[TRACE_RING_SLOTS];
+    int head;       /* slot the caller reads, owned by the caller */
+    int tail;       /* slot being decoded, owned by the thread */
+    int count;      /* decoded slots not yet consumed */
+    size_t pos;     /* records of the head slot already returned */
+    int stop;       /* the reader is being closed */
+} trace_ring_t;
+
+struct trace_reader {
+    int fd;
+    char* fn;
+    int binary;             /* 1 for the binary format, 0 for text */
+    unsigned char* map;     /* whole file when it could be mapped */
+    size_t map_len;
+    unsigned char* buf;     /* read buffer when it could not */
+    unsigned char* cur;     /* next undecoded byte */
+    unsigned char* end;     /* one past the last valid byte */
+    int eof;                /* no more bytes can be read from fd */
+    int skip_line;          /* drop bytes up to the next newline */
+    z_stream* gz;           /* inflater when the trace is gzipped */
+    unsigned char* gz_in;   /* compressed input when it is not mapped */
+    unsigned char* gz_next; /* mapped compressed bytes not yet inflated */
+    size_t gz_left;
+    int gz_in_eof;          /* no more compressed bytes can be read */
+    int gz_in_member;       /* inside a gzip member */
+    trace_ring_t* ring;     /* read-ahead ring once started */
+    mem_addr_t last_iaddr;  /* previous instruction address */
+    mem_addr_t last_daddr;  /* previous data address */
+};
+
+/*
+ * readFd - Read up to len bytes from the trace file.  Returns the
+ *     number of bytes read, 0 at the end of the file or on an error.
+ */
+static size_t readFd(trace_reader_t* tr, unsigned char* dst, size_t len)
+{
+    ssize_t got;
+
+    do {
+        got = read(tr->fd, dst, len);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) {
+        fprintf(stderr, "%s: %s\n", tr->fn, strerror(errno));
+        return 0;
+    }
+    return (size_t)got;
+}
+
+/*
+ * readGzip - Inflate up to len bytes of the trace, moving on to the
+ *     next member of a multi-member gzip file.  Returns the number of
+ *     bytes produced, 0 at the end of the data or on an error.
+ */
+static size_t readGzip(trace_reader_t* tr, unsigned char* dst, size_t len)
+{
+    z_stream* zs = tr->gz;
+    int ret;
+
+    zs->next_out = dst;
+    zs->avail_out = (uInt)len;
+    while (zs->avail_out == len) {
+        if (zs->avail_in == 0 && tr->gz_in && !tr->gz_in_eof) {
+            zs->next_in = tr->gz_in;
+            zs->avail_in = (uInt)readFd(tr, tr->gz_in, TRACE_BUF_SIZE);
+            tr->gz_in_eof = zs->avail_in == 0;
+        } else if (zs->avail_in == 0 && tr->gz_left > 0) {
+            /* avail_in is 32 bits wide, so feed large maps in pieces */
+            size_t chunk = tr->gz_left < (1u << 30) ? tr->gz_left : 1u << 30;
+            zs->next_in = tr->gz_next;
+            zs->avail_in = (uInt)chunk;
+            tr->gz_next += chunk;
+            tr->gz_left -= chunk;
+        }
+        if (zs->avail_in == 0) {
+            if (tr->gz_in_member)
+                fprintf(stderr, "%s: truncated gzip data\n", tr->fn);
+            tr->gz_in_member = 0;
+            break;
+        }
+        ret = inflate(zs, Z_NO_FLUSH);
+        tr->gz_in_member = ret != Z_STREAM_END;
+        if (ret == Z_STREAM_END) {
+            inflateReset(zs);
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf(stderr, "%s: corrupt gzip data\n", tr->fn);
+            zs->avail_in = 0;
+            tr->gz_in_eof = 1;
+            tr->gz_in_member = 0;
+            tr->gz_left = 0;
+            break;
+        }
+    }
+    return len - zs->avail_out;
+}
+
+/*
+ * refill - Move the undecoded tail of the buffer to its start and
+ *     fill the rest from the file or the inflater.  Mapped plain
+ *     traces are never refilled.
+ */
+static void refill(trace_reader_t* tr)
+{
+    size_t left = tr->end - tr->cur;
+    size_t got;
+
+    memmove(tr->buf, tr->cur, left);
+    tr->cur = tr->buf;
+    tr->end = tr->buf + left;
+    while (tr->end < tr->buf + TRACE_BUF_SIZE) {
+        size_t room = tr->buf + TRACE_BUF_SIZE - tr->end;
+
+        got = tr->gz ? readGzip(tr, tr->end, room)
+                     : readFd(tr, tr->end, room);
+        if (got == 0) {
+            tr->eof = 1;
+            break;
+        }
+        tr->end += got;
+    }
+    memset(tr->end, 0, TRACE_BUF_PAD);
+}
+
+/*
+ * startGzip - Inflate the trace from here on.  The compressed bytes
+ *     read so far (the mapped file, or the start of the buffer) become
+ *     the first input of the inflater.  Returns 0 on success.
+ */
+static int startGzip(trace_reader_t* tr)
+{
+    tr->gz = calloc(1, sizeof(z_stream));
+    /* 32 lets zlib accept and skip the gzip header */
+    if (!tr->gz || inflateInit2(tr->gz, 15 + 32) != Z_OK) {
+        fprintf(stderr, "%s: cannot set up gzip decoding\n", tr->fn);
+        free(tr->gz);
+        tr->gz = NULL;
+        return -1;
+    }
+    if (tr->map) {
+        tr->gz_next = tr->map;
+        tr->gz_left = tr->map_len;
+        tr->buf = malloc(TRACE_BUF_SIZE + TRACE_BUF_PAD);
+        if (!tr->buf)
+            goto nomem;
+    } else {
+        tr->gz_in = malloc(TRACE_BUF_SIZE);
+        if (!tr->gz_in)
+            goto nomem;
+        memcpy(tr->gz_in, tr->cur, tr->end - tr->cur);
+        tr->gz->next_in = tr->gz_in;
+        tr->gz->avail_in = (uInt)(tr->end - tr->cur);
+        tr->gz_in_eof = tr->eof;
+    }
+    tr->cur = tr->end = tr->buf;
+    tr->eof = 0;
+    refill(tr);
+    return 0;
+
+nomem:
+    /* traceClose() ends the inflater */
+    fprintf(stderr, "Out of memory\n");
+    return -1;
+}
+
+/*
+ * getVarint - Decode an unsigned LEB128 varint.  Returns NULL if the
+ *     varint runs past end.
+ */
+static inline const unsigned char* getVarint(const unsigned char* p,
+                                             const unsigned char* end,
+                                             unsigned long long* val)
+{
+    unsigned long long v = 0;
+    int shift = 0;
+
+    while (p < end) {
+        unsigned char byte = *p++;
+        v |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *val = v;
+            return p;
+        }
+        shift += 7;
+        if (shift >= 70)
+            return NULL;
+    }
+    return NULL;
+}
+
+/*
+ * putVarint - Encode an unsigned LEB128 varint into out.  Returns the
+ *     number of bytes written.
+ */
+static inline int putVarint(unsigned char* out, unsigned long long v)
+{
+    int n = 0;
+
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+/*
+ * readBinary - Decode records from the binary format.
+ */
+static size_t readBinary(trace_reader_t* tr, trace_access_t* accesses,
+                         size_t max)
+{
+    size_t n = 0;
+
+    while (n < max) {
+        const unsigned char* p;
+        unsigned long long size, delta;
+        mem_addr_t* last;
+        unsigned char tag;
+
+        if (tr->end - tr->cur < TRACE_BIN_MAX_RECORD && !tr->eof)
+            refill(tr);
+        if (tr->cur == tr->end)
+            break;
+
+        p = tr->cur;
+        tag = *p++;
+        size = tag >> 2;
+        if (size == 0 && !(p = getVarint(p, tr->end, &size)))
+            goto truncated;
+        if (!(p = getVarint(p, tr->end, &delta)))
+            goto truncated;
+        tr->cur = (unsigned char*)p;
+
+        last = (tag & 3) == 0 ? &tr->last_iaddr : &tr->last_daddr;
+        /* undo the zig-zag encoding of the signed delta */
+        *last += (delta >> 1) ^ -(delta & 1);
+
+        accesses[n].addr = *last;
+        accesses[n].size = (unsigned int)size;
+        accesses[n].op = op_names[tag & 3];
+        n++;
+    }
+    return n;
+
+truncated:
+    fprintf(stderr, "%s: truncated binary trace record\n", tr->fn);
+    tr->cur = tr->end;
+    return n;
+}
+
+/*
+ * parseHex8 - Decode exactly n (1 to 8) hex digits starting at p
+ *     without branching on each character.  The eight bytes at p must
+ *     be readable.
+ */
+static inline unsigned long long parseHex8(const unsigned char* p, int n)
+{
+    unsigned long long x;
+
+    memcpy(&x, p, 8);
+    /* '0'-'9' keep their low nibble, letters have bit 6 set and need 9 more */
+    x = (x & 0x0f0f0f0f0f0f0f0fULL) + ((x >> 6) & 0x0101010101010101ULL) * 9;
+    /* drop the bytes after the last digit; the first digit is in byte 0 */
+    x <<= (8 - n) * 8;
+    /* merge adjacent digits into bytes, bytes into shorts, shorts into ints */
+    x = ((x << 4) | (x >> 8)) & 0x00ff00ff00ff00ffULL;
+    x = ((x << 8) | (x >> 16)) & 0x0000ffff0000ffffULL;
+    return ((x << 16) | (x >> 32)) & 0xffffffffULL;
+}
+
+/*
+ * nonHexBytes - Mask with the high bit set in every byte of x that is
+ *     not a hex digit.  Each byte is range-checked on its own 7 bits,
+ *     so no carry crosses into the next byte.
+ */
+static inline unsigned long long nonHexBytes(unsigned long long x)
+{
+    const unsigned long long ones = 0x0101010101010101ULL;
+    const unsigned long long high = 0x8080808080808080ULL;
+    unsigned long long low = x & ~high;
+    unsigned long long lower = low | ones * 0x20;
+    unsigned long long digit, letter;
+
+    digit = (low + ones * (128 - '0')) & ~(low + ones * (128 - '9' - 1));
+    letter = (lower + ones * (128 - 'a')) & ~(lower + ones * (128 - 'f' - 1));
+    return (~(digit | letter) | x) & high;
+}
+
+/*
+ * parseHex - Decode the hex number at *pp, which ends by end, leaving
+ *     *pp on the first character after it.  When 16 bytes are readable
+ *     before limit the digits are counted and decoded a word at a time.
+ */
+static inline mem_addr_t parseHex(const unsigned char** pp,
+                                  const unsigned char* end,
+                                  const unsigned char* limit)
+{
+    const unsigned char* p = *pp;
+    unsigned long long x, m;
+    mem_addr_t v = 0;
+    int n;
+
+    if (limit - p >= 16) {
+        /* find the first byte that is not a hex digit in each word */
+        memcpy(&x, p, 8);
+        m = nonHexBytes(x);
+        if (m) {
+            n = __builtin_ctzll(m) >> 3;
+        } else {
+            memcpy(&x, p + 8, 8);
+            m = nonHexBytes(x);
+            n = m ? 8 + (__builtin_ctzll(m) >> 3) : 16;
+        }
+        if (p + n > end)
+            n = (int)(end - p);
+        *pp = p + n;
+        if (n <= 8)
+            return n ? parseHex8(p, n) : 0;
+        return (parseHex8(p, n - 8) << 32) | parseHex8(p + n - 8, 8);
+    }
+
+    for (; p < end && hex_value[*p] < 16; p++)
+        v = (v << 4) | hex_value[*p];
+    *pp = p;
+    return v;
+}
+
+/*
+ * readText - Decode records from a lackey text trace in place
+ */
+static size_t readText(trace_reader_t* tr, trace_access_t* accesses,
+                       size_t max)
+{
+    size_t n = 0;
+
+    while (n < max) {
+        const unsigned char* line = tr->cur;
+        const unsigned char* eol;
+        const unsigned char* p;
+        /* the zeroed padding after a buffer may be read, a map may not */
+        const unsigned char* limit = tr->buf ? tr->end + TRACE_BUF_PAD
+                                             : tr->end;
+        unsigned int size = 0;
+        char op;
+
+        eol = memchr(line, '\n', tr->end - line);
+        if (tr->skip_line) {
+            /* the rest of a dropped line */
+            if (!eol && !tr->eof) {
+                tr->cur = tr->end;
+                refill(tr);
+                continue;
+            }
+            tr->skip_line = 0;
+            tr->cur = (unsigned char*)(eol ? eol + 1 : tr->end);
+            continue;
+        }
+        if (!eol && !tr->eof) {
+            /* a line longer than the whole buffer is dropped */
+            if (line == tr->buf && tr->end == tr->buf + TRACE_BUF_SIZE) {
+                tr->cur = tr->end;
+                tr->skip_line = 1;
+            }
+            refill(tr);
+            continue;
+        }
+        if (!eol) {
+            if (line == tr->end)
+                break;
+            eol = tr->end;
+        }
+        tr->cur = (unsigned char*)(eol < tr->end ? eol + 1 : eol);
+
+        /* line[Y] gives the Yth byte in the trace line */
+        if (eol - line < 4)
+            continue;
+        if (line[0] == 'I')
+            op = 'I';
+        else if (line[1] == 'M' || line[1] == 'L' || line[1] == 'S')
+            op = line[1];
+        else
+            continue;
+
+        p = line + 3;
+        while (p < eol && *p == ' ')
+            p++;
+        accesses[n].addr = parseHex(&p, eol, limit);
+        if (p < eol && *p == ',')
+            p++;
+        while (p < eol && (unsigned)(*p - '0') < 10)
+            size = size * 10 + (*p++ - '0');
+        accesses[n].size = size;
+        accesses[n].op = op;
+        n++;
+    }
+    return n;
+}
+
+/*
+ * initHexTable - Fill hex_value on first use
+ */
+static void initHexTable(void)
+{
+    int i;
+
+    if (hex_value['1'] == 1)
+        return;
+    memset(hex_value, 0xff, sizeof(hex_value));
+    for (i = 0; i < 10; i++)
+        hex_value['0' + i] = i;
+    for (i = 0; i < 6; i++)
+        hex_value['a' + i] = hex_value['A' + i] = 10 + i;
+}
+
+/*
+ * traceOpen - Open a text or binary trace for reading.  Regular files
+ *     are memory-mapped and decoded in place; anything else, and gzip
+ *     data, is read through a buffer.  "-" reads standard input.
+ */
+trace_reader_t* traceOpen(char* trace_fn)
+{
+    trace_reader_t* tr;
+    struct stat st;
+    int is_stdin = strcmp(trace_fn, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(trace_fn, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", trace_fn, strerror(errno));
+        return NULL;
+    }
+
+    initHexTable();
+    tr = calloc(1, sizeof(trace_reader_t));
+    if (!tr) {
+        fprintf(stderr, "Out of memory\n");
+        if (!is_stdin)
+            close(fd);
+        return NULL;
+    }
+    tr->fd = fd;
+    tr->fn = is_stdin ? "stdin" : trace_fn;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            tr->map = map;
+            tr->map_len = st.st_size;
+            tr->cur = tr->map;
+            tr->end = tr->map + tr->map_len;
+            tr->eof = 1;
+        }
+    }
+    if (!tr->map) {
+        tr->buf = malloc(TRACE_BUF_SIZE + TRACE_BUF_PAD);
+        if (!tr->buf) {
+            fprintf(stderr, "Out of memory\n");
+            traceClose(tr);
+            return NULL;
+        }
+        tr->cur = tr->end = tr->buf;
+        refill(tr);
+    }
+
+    /* gzip members start with 1f 8b */
+    if (tr->end - tr->cur >= 2 && tr->cur[0] == 0x1f && tr->cur[1] == 0x8b &&
+        startGzip(tr) < 0) {
+        traceClose(tr);
+        return NULL;
+    }
+
+    if (tr->end - tr->cur >= TRACE_BIN_MAGIC_LEN &&
+        memcmp(tr->cur, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN) == 0) {
+        tr->binary = 1;
+        tr->cur += TRACE_BIN_MAGIC_LEN;
+    }
+    return tr;
+}
+
+/*
+ * openMapped - traceOpen() a trace that must be an uncompressed,
+ *     memory-mapped file.  Returns NULL after printing a message if
+ *     it is not.
+ */
+static trace_reader_t* openMapped(char* trace_fn)
+{
+    trace_reader_t* tr = traceOpen(trace_fn);
+
+    if (tr && (!tr->map || tr->gz)) {
+        fprintf(stderr, "%s: only an uncompressed trace file can be "
+                "split\n", tr->fn);
+        traceClose(tr);
+        return NULL;
+    }
+    return tr;
+}
+
+/*
+ * skipRecord - Step over the binary record at p, updating the
+ *     previous addresses in mark.  Returns NULL if it is truncated.
+ */
+static const unsigned char* skipRecord(const unsigned char* p,
+                                       const unsigned char* end,
+                                       trace_mark_t* mark)
+{
+    unsigned long long size, delta;
+    unsigned char tag = *p++;
+    mem_addr_t* last = (tag & 3) == 0 ? &mark->last_iaddr
+                                      : &mark->last_daddr;
+
+    if ((tag >> 2) == 0 && !(p = getVarint(p, end, &size)))
+        return NULL;
+    if (!(p = getVarint(p, end, &delta)))
+        return NULL;
+    *last += (delta >> 1) ^ -(delta & 1);
+    return p;
+}
+
+/*
+ * splitBinary - traceSplit() a binary trace: one pass counts the
+ *     records, a second marks the ones chunks and warm-ups start at
+ */
+static void splitBinary(trace_reader_t* tr, int n, long long warmup,
+                        trace_mark_t* warmups, trace_mark_t* starts)
+{
+    const unsigned char* p = tr->cur;
+    unsigned long long records = 0, index, start;
+    trace_mark_t mark = { 0, 0, 0 };
+    int w = 0, i = 0;
+
+    while (p < tr->end && (p = skipRecord(p, tr->end, &mark)))
+        records++;
+
+    p = tr->cur;
+    memset(&mark, 0, sizeof(mark));
+    for (index = 0;; index++) {
+        mark.offset = p - tr->map;
+        /* warm-ups start in the same order as their chunks */
+        while (w < n) {
+            start = records * w / n;
+            if ((start > (unsigned long long)warmup ? start - warmup : 0) !=
+                index)
+                break;
+            warmups[w++] = mark;
+        }
+        while (i < n && records * i / n == index)
+            starts[i++] = mark;
+        if (i == n || p >= tr->end || !(p = skipRecord(p, tr->end, &mark)))
+            break;
+    }
+    /* only a truncated trace ends before every chunk started */
+    while (w < n)
+        warmups[w++] = mark;
+    while (i < n)
+        starts[i++] = mark;
+}
+
+/*
+ * splitText - traceSplit() a text trace at the line breaks after equal
+ *     byte offsets, walking back warmup lines from each
+ */
+static void splitText(trace_reader_t* tr, int n, long long warmup,
+                      trace_mark_t* warmups, trace_mark_t* starts)
+{
+    const unsigned char* first = tr->cur;
+    size_t len = tr->end - first;
+
+    for (int i = 0; i < n; i++) {
+        const unsigned char* p = first + len * i / n;
+        long long lines;
+
+        if (p > first && p[-1] != '\n') {
+            const unsigned char* eol = memchr(p, '\n', tr->end - p);
+            p = eol ? eol + 1 : tr->end;
+        }
+        memset(&starts[i], 0, sizeof(trace_mark_t));
+        starts[i].offset = p - tr->map;
+
+        for (lines = 0; lines < warmup && p > first; lines++) {
+            p--;
+            while (p > first && p[-1] != '\n')
+                p--;
+        }
+        memset(&warmups[i], 0, sizeof(trace_mark_t));
+        warmups[i].offset = p - tr->map;
+    }
+}
+
+/*
+ * traceSplit - Cut a trace file into chunks without decoding it
+ */
+int traceSplit(char* trace_fn, int n, long long warmup,
+               trace_mark_t* warmups, trace_mark_t* starts)
+{
+    trace_reader_t* tr = openMapped(trace_fn);
+
+    if (!tr)
+        return -1;
+    if (tr->binary)
+        splitBinary(tr, n, warmup, warmups, starts);
+    else
+        splitText(tr, n, warmup, warmups, starts);
+    memset(&starts[n], 0, sizeof(trace_mark_t));
+    starts[n].offset = tr->map_len;
+    traceClose(tr);
+    return 0;
+}
+
+/*
+ * traceOpenRange - Open a reader for the records between two marks
+ */
+trace_reader_t* traceOpenRange(char* trace_fn, const trace_mark_t* from,
+                               const trace_mark_t* to)
+{
+    trace_reader_t* tr = openMapped(trace_fn);
+
+    if (!tr)
+        return NULL;
+    tr->cur = tr->map + from->offset;
+    tr->end = tr->map + to->offset;
+    tr->last_iaddr = from->last_iaddr;
+    tr->last_daddr = from->last_daddr;
+    return tr;
+}
+
+/*
+ * decode - Decode up to max records in the calling thread
+ */
+static size_t decode(trace_reader_t* tr, trace_access_t* accesses,
+                     size_t max)
+{
+    if (tr->binary)
+        return readBinary(tr, accesses, max);
+    return readText(tr, accesses, max);
+}
+
+/*
+ * readAhead - Body of the read-ahead thread: decode batches into the
+ *     ring until the trace ends or the reader is closed
+ */
+static void* readAhead(void* arg)
+{
+    trace_reader_t* tr = arg;
+    trace_ring_t* ring = tr->ring;
+
+    for (;;) {
+        trace_slot_t* slot = &ring->slots[ring->tail];
+
+        pthread_mutex_lock(&ring->lock);
+        while (ring->count == TRACE_RING_SLOTS && !ring->stop)
+            pthread_cond_wait(&ring->not_full, &ring->lock);
+        if (ring->stop) {
+            pthread_mutex_unlock(&ring->lock);
+            break;
+        }
+        pthread_mutex_unlock(&ring->lock);
+
+        /* the slot is free, so it can be filled without the lock */
+        slot->len = decode(tr, slot->accesses, TRACE_BATCH);
+
+        pthread_mutex_lock(&ring->lock);
+        ring->count++;
+        pthread_cond_signal(&ring->not_empty);
+        pthread_mutex_unlock(&ring->lock);
+        ring->tail = (ring->tail + 1) % TRACE_RING_SLOTS;
+        if (slot->len == 0)
+            break;
+    }
+    return NULL;
+}
+
+/*
+ * traceStartReadAhead - Move decoding to a read-ahead thread
+ */
+int traceStartReadAhead(trace_reader_t* tr)
+{
+    trace_ring_t* ring;
+
+    if (tr->ring || sysconf(_SC_NPROCESSORS_ONLN) < 2)
+        return 0;
+    ring = calloc(1, sizeof(trace_ring_t));
+    if (!ring)
+        return -1;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->not_empty, NULL);
+    pthread_cond_init(&ring->not_full, NULL);
+    tr->ring = ring;
+    if (pthread_create(&ring->thread, NULL, readAhead, tr) != 0) {
+        tr->ring = NULL;
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->not_empty);
+        pthread_cond_destroy(&ring->not_full);
+        free(ring);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * traceRead - Decode up to max records into accesses, or copy them out
+ *     of the read-ahead ring
+ */
+size_t traceRead(trace_reader_t* tr, trace_access_t* accesses, size_t max)
+{
+    trace_ring_t* ring = tr->ring;
+    trace_slot_t* slot;
+    size_t n;
+
+    if (!ring)
+        return decode(tr, accesses, max);
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->count == 0)
+        pthread_cond_wait(&ring->not_empty, &ring->lock);
+    pthread_mutex_unlock(&ring->lock);
+
+    /* the end marker stays in the ring so later calls see it too */
+    slot = &ring->slots[ring->head];
+    if (slot->len == 0)
+        return 0;
+    n = slot->len - ring->pos < max ? slot->len - ring->pos : max;
+    memcpy(accesses, slot->accesses + ring->pos, n * sizeof(trace_access_t));
+    ring->pos += n;
+    if (ring->pos == slot->len) {
+        ring->pos = 0;
+        ring->head = (ring->head + 1) % TRACE_RING_SLOTS;
+        pthread_mutex_lock(&ring->lock);
+        ring->count--;
+        pthread_cond_signal(&ring->not_full);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return n;
+}
+
+/*
+ * traceClose - Stop the read-ahead thread and release the reader and
+ *     its file
+ */
+void traceClose(trace_reader_t* tr)
+{
+    trace_ring_t* ring = tr->ring;
+
+    if (ring) {
+        pthread_mutex_lock(&ring->lock);
+        ring->stop = 1;
+        pthread_cond_signal(&ring->not_full);
+        pthread_mutex_unlock(&ring->lock);
+        pthread_join(ring->thread, NULL);
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->not_empty);
+        pthread_cond_destroy(&ring->not_full);
+        free(ring);
+    }
+    if (tr->gz) {
+        inflateEnd(tr->gz);
+        free(tr->gz);
+    }
+    if (tr->map)
+        munmap(tr->map, tr->map_len);
+    if (tr->fd != STDIN_FILENO)
+        close(tr->fd);
+    free(tr->gz_in);
+    free(tr->buf);
+    free(tr);
+}
+
+/*
+ * traceWriterInit - Write the binary header to fp
+ */
+int traceWriterInit(trace_writer_t* tw, FILE* fp)
+{
+    tw->fp = fp;
+    tw->last_iaddr = 0;
+    tw->last_daddr = 0;
+    if (fwrite(TRACE_BIN_MAGIC, 1, TRACE_BIN_MAGIC_LEN, fp)
+        != TRACE_BIN_MAGIC_LEN)
+        return -1;
+    return 0;
+}
+
+/*
+ * traceWrite - Append one record to a binary trace
+ */
+int traceWrite(trace_writer_t* tw, const trace_access_t* access)
+{
+    unsigned char rec[TRACE_BIN_MAX_RECORD];
+    mem_addr_t* last;
+    long long delta;
+    int op, len = 1;
+
+    switch (access->op) {
+    case 'I': op = 0; break;
+    case 'L': op = 1; break;
+    case 'S': op = 2; break;
+    case 'M': op = 3; break;
+    default:
+        return -1;
+    }
+
+    if (access->size > 0 && access->size < 64) {
+        rec[0] = (unsigned char)(op | (access->size << 2));
+    } else {
+        rec[0] = (unsigned char)op;
+        len += putVarint(rec + len, access->size);
+    }
+
+    last = op == 0 ? &tw->last_iaddr : &tw->last_daddr;
+    delta = (long long)(access->addr - *last);
+    *last = access->addr;
+    /* zig-zag encode so that small negative deltas stay short */
+    len += putVarint(rec + len, ((unsigned long long)delta << 1) ^
+                                (unsigned long long)(delta >> 63));
+
+    if (fwrite(rec, 1, len, tw->fp) != (size_t)len)
+        return -1;
+    return 0;
+}
+
+/*
+ * traceWriteText - Print one record as a lackey text line
+ */
+int traceWriteText(FILE* fp, const trace_access_t* access)
+{
+    int written;
+
+    if (access->op == 'I')
+        written = fprintf(fp, "I  %08llx,%u\n", access->addr, access->size);
+    else
+        written = fprintf(fp, " %c %08llx,%u\n", access->op, access->addr,
+                          access->size);
+    return written < 0 ? -1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * trace.h - Readers and writers for memory traces replayed by csim
+ *
+ * Two on-disk formats are understood:
+ *
+ *   text    The output of "valgrind --tool=lackey --trace-mem=yes",
+ *           one access per line ("I  0400d7d4,8", " L 7ff0005b8,8").
+ *
+ *   binary  A compact format produced by traceconv.  The file starts
+ *           with the 8 byte magic TRACE_BIN_MAGIC and is followed by one
+ *           variable-length record per access:
+ *
+ *             tag     1 byte: bits 0-1 op (I, L, S, M),
+ *                     bits 2-7 access size, or 0 if a varint size follows
+ *             [size]  unsigned LEB128 varint, only when the tag size is 0
+ *             delta   zig-zag LEB128 varint of the address minus the
+ *                     previous address of the same stream
+ *
+ *           Instruction fetches and data accesses keep separate previous
+ *           addresses, so most deltas fit in one or two bytes.
+ *
+ * traceOpen() recognises the format from the first bytes of the file,
+ * after undoing gzip compression if the file starts with the gzip
+ * magic.  The name "-" stands for standard input, so lackey can be
+ * piped into csim.  Regular files are memory-mapped and decoded in
+ * place, so neither format is copied through stdio.
+ */
+#ifndef CSIM_TRACE_H
+#define CSIM_TRACE_H
+
+#include <stdio.h>
+
+/* Type: Memory address */
+typedef unsigned long long int mem_addr_t;
+
+/* Type: One decoded trace record */
+typedef struct trace_access {
+    mem_addr_t addr;   /* address of the first byte accessed */
+    unsigned int size; /* number of bytes accessed */
+    char op;           /* 'I', 'L', 'S' or 'M' */
+} trace_access_t;
+
+/* Number of records callers usually ask traceRead() for at once */
+#define TRACE_BATCH 4096
+
+#define TRACE_BIN_MAGIC "CSIMTRC1"
+#define TRACE_BIN_MAGIC_LEN 8
+/* Largest possible binary record: tag + 5 byte size + 10 byte delta */
+#define TRACE_BIN_MAX_RECORD 16
+
+/* Type: Opaque trace reader */
+typedef struct trace_reader trace_reader_t;
+
+/* Type: Position of a record in a trace file, from traceSplit() */
+typedef struct trace_mark {
+    size_t offset;         /* byte offset of the record in the file */
+    mem_addr_t last_iaddr; /* previous addresses of a binary trace */
+    mem_addr_t last_daddr;
+} trace_mark_t;
+
+/* Type: Binary trace writer */
+typedef struct trace_writer {
+    FILE* fp;
+    mem_addr_t last_iaddr; /* previous instruction address */
+    mem_addr_t last_daddr; /* previous data address */
+} trace_writer_t;
+
+/*
+ * traceOpen - Open a text or binary trace for reading.  Returns NULL
+ *     after printing a message to stderr if the file cannot be used.
+ */
+trace_reader_t* traceOpen(char* trace_fn);
+
+/*
+ * traceStartReadAhead - Decode the rest of the trace in a separate
+ *     thread that runs a few batches ahead of traceRead().  Does
+ *     nothing when only one CPU is online.  Returns 0 on success.
+ */
+int traceStartReadAhead(trace_reader_t* tr);
+
+/*
+ * traceRead - Decode up to max records into accesses.  Returns the
+ *     number of records stored, 0 at the end of the trace.
+ */
+size_t traceRead(trace_reader_t* tr, trace_access_t* accesses, size_t max);
+
+/*
+ * traceSplit - Cut an uncompressed trace file into n chunks of about
+ *     equal size without decoding it.  starts[i] marks the first
+ *     record of chunk i, starts[n] the end of the trace, and
+ *     warmups[i] the record about warmup records before starts[i] (or
+ *     the first record).  A binary trace is scanned once to find
+ *     record boundaries and the previous addresses there; a text
+ *     trace is cut at the line breaks near the boundaries and counts
+ *     lines as records.  Returns 0, or -1 after printing a message.
+ */
+int traceSplit(char* trace_fn, int n, long long warmup,
+               trace_mark_t* warmups, trace_mark_t* starts);
+
+/*
+ * traceOpenRange - Open a reader for the records of a trace file from
+ *     mark from up to mark to, both from traceSplit().  Returns NULL
+ *     after printing a message on failure.
+ */
+trace_reader_t* traceOpenRange(char* trace_fn, const trace_mark_t* from,
+                               const trace_mark_t* to);
+
+/* traceClose - Release the reader and its file */
+void traceClose(trace_reader_t* tr);
+
+/* traceWriterInit - Write the binary header to fp. Returns 0 on success */
+int traceWriterInit(trace_writer_t* tw, FILE* fp);
+
+/* traceWrite - Append one record to a binary trace. Returns 0 on success */
+int traceWrite(trace_writer_t* tw, const trace_access_t* access);
+
+/*
+ * traceWriteText - Print one record to fp the way lackey does.
+ *     Returns 0 on success.
+ */
+int traceWriteText(FILE* fp, const trace_access_t* access);
+
+#endif /* CSIM_TRACE_H */
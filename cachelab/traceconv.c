@@ -0,0 +1,105 @@
+/*
+ * traceconv.c - Convert Valgrind lackey text traces to the compact
+ *     binary trace format read by csim, and back again.
+ *
+ * Any trace csim can read is accepted as input, including gzipped
+ * traces and "-" for stdin, so running traceconv with -d on a binary
+ * trace reproduces the lackey text.
+ */
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "trace.h"
+
+/*
+ * printUsage - Print usage info
+ */
+static void printUsage(char* argv[])
+{
+    printf("Usage: %s [-hd] -i <file> -o <file>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -d         Write lackey text instead of the binary format.\n");
+    printf("  -i <file>  Input trace (text or binary, may be gzipped, - for stdin).\n");
+    printf("  -o <file>  Output trace.\n");
+    printf("\nExamples:\n");
+    printf("  linux>  %s -i traces/long.trace -o long.btrace\n", argv[0]);
+    printf("  linux>  %s -d -i long.btrace -o long.trace\n", argv[0]);
+}
+
+/*
+ * main - Main routine
+ */
+int main(int argc, char* argv[])
+{
+    trace_access_t batch[TRACE_BATCH];
+    trace_writer_t tw;
+    trace_reader_t* tr;
+    char* in_fn = NULL;
+    char* out_fn = NULL;
+    int to_text = 0;
+    size_t i, n;
+    FILE* out_fp;
+    char c;
+
+    while( (c=getopt(argc,argv,"i:o:dh")) != -1){
+        switch(c){
+        case 'i':
+            in_fn = optarg;
+            break;
+        case 'o':
+            out_fn = optarg;
+            break;
+        case 'd':
+            to_text = 1;
+            break;
+        case 'h':
+            printUsage(argv);
+            exit(0);
+        default:
+            printUsage(argv);
+            exit(1);
+        }
+    }
+
+    if (in_fn == NULL || out_fn == NULL) {
+        printf("%s: Missing required command line argument\n", argv[0]);
+        printUsage(argv);
+        exit(1);
+    }
+
+    tr = traceOpen(in_fn);
+    if (!tr)
+        exit(1);
+    traceStartReadAhead(tr);
+
+    out_fp = fopen(out_fn, "wb");
+    if (!out_fp) {
+        fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+        exit(1);
+    }
+    if (!to_text && traceWriterInit(&tw, out_fp) < 0)
+        goto write_error;
+
+    while ((n = traceRead(tr, batch, TRACE_BATCH)) > 0) {
+        for (i = 0; i < n; i++) {
+            if (to_text ? traceWriteText(out_fp, &batch[i]) < 0
+                        : traceWrite(&tw, &batch[i]) < 0)
+                goto write_error;
+        }
+    }
+
+    traceClose(tr);
+    if (fclose(out_fp) != 0) {
+        fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+        exit(1);
+    }
+    return 0;
+
+write_error:
+    fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+    exit(1);
+}
@@ -0,0 +1,368 @@
+/*
+ * tracesynth.c - Write synthetic memory traces in lackey format (or
+ *     the binary format of traceconv) for testing and benchmarking
+ *     csim on access patterns of any size.
+ *
+ * Every pattern touches a working set of -w bytes starting at
+ * SYNTH_BASE and repeats over it until -n data accesses are written:
+ *
+ *   seq        consecutive elements of -z bytes
+ *   stride     every -s bytes
+ *   random     uniformly random elements
+ *   zipf       elements drawn from a Zipf distribution of exponent -a
+ *              (0 < a < 1), the popular ones scattered over the set
+ *   chase      nodes of -s bytes visited along one random cycle, as a
+ *              linked list walk would
+ *   transpose  B[j][i] = A[i][j] over two square int matrices
+ *
+ * seq, stride, random and zipf make a fraction -r of the accesses
+ * stores.  With -i every data access follows an instruction fetch
+ * from a small loop, like lackey output of a real loop.
+ */
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include "trace.h"
+
+/* Address of the first byte of the working set */
+#define SYNTH_BASE 0x10000000ULL
+/* Address and number of instructions of the loop emitted with -i */
+#define SYNTH_LOOP_PC 0x400000ULL
+#define SYNTH_LOOP_LEN 4
+
+typedef enum { SEQ, STRIDE, RANDOM, ZIPF, CHASE, TRANSPOSE } pattern_t;
+
+static const char* pattern_names[] = {
+    "seq", "stride", "random", "zipf", "chase", "transpose"
+};
+
+/* Type: State of the generator */
+typedef struct synth {
+    pattern_t pattern;
+    unsigned long long int working_set; /* bytes */
+    unsigned long long int elements;    /* elements or nodes in the set */
+    unsigned int size;                  /* bytes per access */
+    unsigned long long int stride;
+    double store_ratio;
+    unsigned long long int rng;
+
+    /* zipf */
+    double theta, zetan, eta;
+
+    /* chase */
+    unsigned long long int* next;
+    unsigned long long int node;
+
+    /* transpose */
+    unsigned long long int dim;
+} synth_t;
+
+/*
+ * nextRandom - Next number of a splitmix64 sequence
+ */
+static unsigned long long nextRandom(synth_t* g)
+{
+    unsigned long long z = (g->rng += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * uniform - Random double in [0, 1)
+ */
+static double uniform(synth_t* g)
+{
+    return (nextRandom(g) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * parseBytes - Parse a byte count with an optional k, m or g suffix.
+ *     Returns 0 if the text is not one.
+ */
+static unsigned long long parseBytes(const char* text)
+{
+    char* end;
+    unsigned long long n = strtoull(text, &end, 10);
+
+    if (end == text)
+        return 0;
+    switch (*end) {
+    case 'k': case 'K': n <<= 10; end++; break;
+    case 'm': case 'M': n <<= 20; end++; break;
+    case 'g': case 'G': n <<= 30; end++; break;
+    }
+    return *end == '\0' ? n : 0;
+}
+
+/*
+ * initZipf - Precompute the constants of the Zipf sampler of Gray et
+ *     al., "Quickly generating billion-record synthetic databases"
+ */
+static void initZipf(synth_t* g)
+{
+    double zeta2 = 1 + pow(0.5, g->theta);
+
+    g->zetan = 0;
+    for (unsigned long long i = 1; i <= g->elements; i++)
+        g->zetan += pow((double)i, -g->theta);
+    g->eta = (1 - pow(2.0 / g->elements, 1 - g->theta)) /
+             (1 - zeta2 / g->zetan);
+}
+
+/*
+ * zipfElement - Draw an element, scattering the ranks over the set
+ */
+static unsigned long long zipfElement(synth_t* g)
+{
+    double u = uniform(g), uz = u * g->zetan;
+    unsigned long long rank, h;
+
+    if (uz < 1)
+        rank = 0;
+    else if (uz < 1 + pow(0.5, g->theta))
+        rank = 1;
+    else
+        rank = (unsigned long long)(g->elements *
+               pow(g->eta * u - g->eta + 1, 1 / (1 - g->theta)));
+    if (rank >= g->elements)
+        rank = g->elements - 1;
+    h = (rank + 1) * 0x9e3779b97f4a7c15ULL;
+    return (h ^ (h >> 29)) % g->elements;
+}
+
+/*
+ * initChase - Link the nodes into one random cycle (Sattolo's
+ *     algorithm).  Returns 0 on success.
+ */
+static int initChase(synth_t* g)
+{
+    g->next = malloc(g->elements * sizeof(unsigned long long));
+    if (!g->next)
+        return -1;
+    for (unsigned long long i = 0; i < g->elements; i++)
+        g->next[i] = i;
+    for (unsigned long long i = g->elements - 1; i > 0; i--) {
+        unsigned long long j = nextRandom(g) % i;
+        unsigned long long t = g->next[i];
+        g->next[i] = g->next[j];
+        g->next[j] = t;
+    }
+    g->node = 0;
+    return 0;
+}
+
+/*
+ * generate - Fill in the k-th data access
+ */
+static void generate(synth_t* g, unsigned long long k, trace_access_t* access)
+{
+    unsigned long long offset;
+
+    access->size = g->size;
+    access->op = 'L';
+    switch (g->pattern) {
+    case SEQ:
+        offset = k % g->elements * g->size;
+        break;
+    case STRIDE:
+        offset = k % g->elements * g->stride;
+        break;
+    case RANDOM:
+        offset = nextRandom(g) % g->elements * g->size;
+        break;
+    case ZIPF:
+        offset = zipfElement(g) * g->size;
+        break;
+    case CHASE:
+        offset = g->node * g->stride;
+        g->node = g->next[g->node];
+        break;
+    case TRANSPOSE:
+    default: {
+        unsigned long long cell = k / 2 % (g->dim * g->dim);
+        unsigned long long i = cell / g->dim, j = cell % g->dim;
+
+        access->size = 4;
+        if (k % 2 == 0) {
+            offset = (i * g->dim + j) * 4;
+        } else {
+            offset = g->dim * g->dim * 4 + (j * g->dim + i) * 4;
+            access->op = 'S';
+        }
+        access->addr = SYNTH_BASE + offset;
+        return;
+    }
+    }
+    if (g->pattern != CHASE && g->store_ratio > 0 &&
+        uniform(g) < g->store_ratio)
+        access->op = 'S';
+    access->addr = SYNTH_BASE + offset;
+}
+
+/*
+ * printUsage - Print usage info
+ */
+static void printUsage(char* argv[])
+{
+    printf("Usage: %s [-hib] -p <pattern> -n <num> -w <bytes> [-s <bytes>] [-z <bytes>]\n", argv[0]);
+    printf("       [-a <theta>] [-r <ratio>] [-S <seed>] [-o <file>]\n");
+    printf("Options:\n");
+    printf("  -h          Print this help message.\n");
+    printf("  -p <name>   Pattern: seq, stride, random, zipf, chase or\n");
+    printf("              transpose.\n");
+    printf("  -n <num>    Number of data accesses.\n");
+    printf("  -w <bytes>  Working set size, may end in k, m or g.\n");
+    printf("  -s <bytes>  Stride of stride, node size of chase (default 64).\n");
+    printf("  -z <bytes>  Bytes per access (default 8).\n");
+    printf("  -a <theta>  Zipf exponent, between 0 and 1 (default 0.99).\n");
+    printf("  -r <ratio>  Fraction of stores (default 0).\n");
+    printf("  -S <seed>   Random seed (default 1).\n");
+    printf("  -i          Precede every data access by an instruction fetch.\n");
+    printf("  -b          Write the binary format instead of lackey text.\n");
+    printf("  -o <file>   Output trace (default: - for stdout).\n");
+    printf("\nExamples:\n");
+    printf("  linux>  %s -p seq -n 1000000 -w 1m -o seq.trace\n", argv[0]);
+    printf("  linux>  %s -p zipf -a 0.9 -r 0.3 -n 100000000 -w 64m -b -o zipf.btrace\n", argv[0]);
+    printf("  linux>  %s -p chase -n 1000000 -w 16m | ./csim -s 10 -E 8 -b 6 -t -\n", argv[0]);
+}
+
+/*
+ * main - Main routine
+ */
+int main(int argc, char* argv[])
+{
+    trace_access_t access, fetch;
+    trace_writer_t tw;
+    synth_t g;
+    char* out_fn = "-";
+    unsigned long long int count = 0;
+    int binary = 0, fetches = 0, pattern = -1;
+    FILE* out_fp;
+    char c;
+
+    memset(&g, 0, sizeof(synth_t));
+    g.size = 8;
+    g.stride = 64;
+    g.theta = 0.99;
+    g.rng = 1;
+
+    while( (c=getopt(argc,argv,"p:n:w:s:z:a:r:S:o:ibh")) != -1){
+        switch(c){
+        case 'p':
+            for (pattern = TRANSPOSE; pattern >= 0; pattern--)
+                if (strcmp(optarg, pattern_names[pattern]) == 0)
+                    break;
+            if (pattern < 0) {
+                printf("%s: Unknown pattern %s\n", argv[0], optarg);
+                printUsage(argv);
+                exit(1);
+            }
+            g.pattern = pattern;
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 10);
+            break;
+        case 'w':
+            g.working_set = parseBytes(optarg);
+            break;
+        case 's':
+            g.stride = parseBytes(optarg);
+            break;
+        case 'z':
+            g.size = (unsigned int)parseBytes(optarg);
+            break;
+        case 'a':
+            g.theta = atof(optarg);
+            break;
+        case 'r':
+            g.store_ratio = atof(optarg);
+            break;
+        case 'S':
+            g.rng = strtoull(optarg, NULL, 10);
+            break;
+        case 'o':
+            out_fn = optarg;
+            break;
+        case 'i':
+            fetches = 1;
+            break;
+        case 'b':
+            binary = 1;
+            break;
+        case 'h':
+            printUsage(argv);
+            exit(0);
+        default:
+            printUsage(argv);
+            exit(1);
+        }
+    }
+
+    if (pattern < 0 || count == 0 || g.working_set == 0) {
+        printf("%s: Missing required command line argument\n", argv[0]);
+        printUsage(argv);
+        exit(1);
+    }
+    if (g.size == 0 || g.stride == 0 || g.theta <= 0 || g.theta >= 1) {
+        printf("%s: Bad access size, stride or Zipf exponent\n", argv[0]);
+        exit(1);
+    }
+
+    /* the working set in units of what the pattern steps over */
+    if (g.pattern == STRIDE || g.pattern == CHASE)
+        g.elements = g.working_set / g.stride;
+    else if (g.pattern == TRANSPOSE)
+        g.elements = g.dim = (unsigned long long)sqrt(g.working_set / 8.0);
+    else
+        g.elements = g.working_set / g.size;
+    if (g.elements == 0) {
+        printf("%s: The working set is too small\n", argv[0]);
+        exit(1);
+    }
+    if (g.pattern == ZIPF)
+        initZipf(&g);
+    if (g.pattern == CHASE && initChase(&g) < 0) {
+        printf("%s: Out of memory\n", argv[0]);
+        exit(1);
+    }
+
+    out_fp = strcmp(out_fn, "-") == 0 ? stdout : fopen(out_fn, "wb");
+    if (!out_fp) {
+        fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+        exit(1);
+    }
+    if (binary && traceWriterInit(&tw, out_fp) < 0)
+        goto write_error;
+
+    fetch.op = 'I';
+    fetch.size = 4;
+    for (unsigned long long k = 0; k < count; k++) {
+        generate(&g, k, &access);
+        if (fetches) {
+            fetch.addr = SYNTH_LOOP_PC + 4 * (k % SYNTH_LOOP_LEN);
+            if (binary ? traceWrite(&tw, &fetch) < 0
+                       : traceWriteText(out_fp, &fetch) < 0)
+                goto write_error;
+        }
+        if (binary ? traceWrite(&tw, &access) < 0
+                   : traceWriteText(out_fp, &access) < 0)
+            goto write_error;
+    }
+
+    free(g.next);
+    if (fclose(out_fp) != 0) {
+        fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+        exit(1);
+    }
+    return 0;
+
+write_error:
+    fprintf(stderr, "%s: %s\n", out_fn, strerror(errno));
+    exit(1);
+}
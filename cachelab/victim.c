@@ -0,0 +1,105 @@
+/*
+ * victim.c - Victim caches and miss caches, see victim.h
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "victim.h"
+
+/*
+ * initVictimCache - Parse spec and attach the buffer to cache
+ */
+int initVictimCache(victim_cache_t* vc, cache_t* cache, const char* spec)
+{
+    const char* count = spec;
+    char* end;
+    long entries;
+
+    memset(vc, 0, sizeof(victim_cache_t));
+    if (strncmp(spec, "victim:", 7) == 0) {
+        count = spec + 7;
+    } else if (strncmp(spec, "miss:", 5) == 0) {
+        vc->miss_cache = 1;
+        count = spec + 5;
+    }
+    entries = strtol(count, &end, 10);
+    if (end == count || *end != '\0' || entries < 1 || entries > 4096) {
+        fprintf(stderr, "Bad victim cache: %s\n", spec);
+        return -1;
+    }
+    vc->entries = (int)entries;
+    vc->lines = calloc(vc->entries, sizeof(victim_entry_t));
+    if (!vc->lines) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    cache->victim = vc;
+    return 0;
+}
+
+/*
+ * freeVictimCache - Detach the buffer and free allocated memory
+ */
+void freeVictimCache(victim_cache_t* vc, cache_t* cache)
+{
+    if (cache->victim == vc)
+        cache->victim = NULL;
+    free(vc->lines);
+    vc->lines = NULL;
+}
+
+/*
+ * victimLookup - Look up a block the cache missed
+ */
+int victimLookup(victim_cache_t* vc, mem_addr_t block, int* dirty,
+                 int demand)
+{
+    vc->lookups += demand;
+    vc->now++;
+    for (int i = 0; i < vc->entries; i++) {
+        victim_entry_t* line = &vc->lines[i];
+
+        if (!line->valid || line->block != block)
+            continue;
+        vc->hits += demand;
+        *dirty = line->dirty;
+        if (vc->miss_cache)
+            line->last_use = vc->now;
+        else
+            line->valid = 0;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * victimInsert - Put a block into an empty or the LRU entry
+ */
+int victimInsert(victim_cache_t* vc, mem_addr_t block, int dirty)
+{
+    victim_entry_t* line = &vc->lines[0];
+    int writeback;
+
+    for (int i = 1; i < vc->entries && line->valid; i++)
+        if (!vc->lines[i].valid || vc->lines[i].last_use < line->last_use)
+            line = &vc->lines[i];
+    writeback = line->valid && line->dirty;
+    line->block = block;
+    line->last_use = vc->now;
+    line->valid = 1;
+    line->dirty = dirty;
+    return writeback;
+}
+
+/*
+ * printVictimCache - Print the buffer counters
+ */
+void printVictimCache(const victim_cache_t* vc, FILE* fp)
+{
+    /* every hit is a miss the next level did not have to serve */
+    fprintf(fp, "%s cache hits:%llu misses:%llu swaps:%llu "
+            "saved_misses:%llu hit_rate:%.2f%%\n",
+            vc->miss_cache ? "miss" : "victim", vc->hits,
+            vc->lookups - vc->hits, vc->swaps, vc->hits,
+            vc->lookups ? 100.0 * vc->hits / vc->lookups : 0.0);
+}
@@ -0,0 +1,73 @@
+/*
+ * victim.h - Victim caches and miss caches behind a cache
+ *
+ * Both are small fully-associative LRU buffers of whole blocks that
+ * are looked up when the cache they are attached to misses:
+ *
+ *   victim  Lines evicted from the cache move into the buffer.  A
+ *           miss that hits the buffer takes the block back and, if
+ *           the cache evicted a line to make room, swaps the two.
+ *           Dirty lines stay dirty in the buffer and are written back
+ *           when they leave it.
+ *   miss    Blocks the cache fetches from the next level are also
+ *           copied into the buffer, and evicted lines are dropped.
+ *
+ * A miss that hits the buffer still counts as a miss of the cache,
+ * but brings no bytes in from the next level: it is a saved miss.
+ * Stores that miss a no-write-allocate cache bypass the buffer.
+ */
+#ifndef CSIM_VICTIM_H
+#define CSIM_VICTIM_H
+
+#include <stdio.h>
+#include "cache.h"
+
+/* Type: One buffer entry */
+typedef struct victim_entry {
+    mem_addr_t block;
+    unsigned long long int last_use;
+    char valid;
+    char dirty;
+} victim_entry_t;
+
+/* Type: Victim or miss cache */
+typedef struct victim_cache {
+    int miss_cache;  /* 1 for a miss cache, 0 for a victim cache */
+    int entries;
+    victim_entry_t* lines;
+    unsigned long long int now;
+
+    unsigned long long int lookups; /* demand misses of the cache */
+    unsigned long long int hits;
+    unsigned long long int swaps;
+} victim_cache_t;
+
+/*
+ * initVictimCache - Attach a buffer described by spec, "entries",
+ *     "victim:entries" or "miss:entries", to cache.  Returns 0 on
+ *     success or -1 after printing an error.
+ */
+int initVictimCache(victim_cache_t* vc, cache_t* cache, const char* spec);
+
+/* freeVictimCache - Detach the buffer and free allocated memory */
+void freeVictimCache(victim_cache_t* vc, cache_t* cache);
+
+/*
+ * victimLookup - Look up the block of a missing addr.  Returns 1 and
+ *     sets *dirty on a hit, which a victim cache also removes, else 0.
+ *     Only demand lookups (demand 1) count as lookups and hits.
+ */
+int victimLookup(victim_cache_t* vc, mem_addr_t block, int* dirty,
+                 int demand);
+
+/*
+ * victimInsert - Offer a block to the buffer: an evicted line to a
+ *     victim cache, a fetched block to a miss cache.  Returns 1 if a
+ *     dirty line had to leave the buffer and must be written back.
+ */
+int victimInsert(victim_cache_t* vc, mem_addr_t block, int dirty);
+
+/* printVictimCache - Print the buffer counters */
+void printVictimCache(const victim_cache_t* vc, FILE* fp);
+
+#endif /* CSIM_VICTIM_H */
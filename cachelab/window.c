@@ -0,0 +1,108 @@
+/*
+ * window.c - Windowed time series of cache counters, see window.h
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "window.h"
+
+/*
+ * initWindows - Open the output and write its header
+ */
+int initWindows(window_writer_t* ww, const char* fn,
+                unsigned long long int window)
+{
+    size_t len = strlen(fn);
+
+    memset(ww, 0, sizeof(window_writer_t));
+    if (window == 0) {
+        fprintf(stderr, "The window must hold at least one access\n");
+        return -1;
+    }
+    ww->window = window;
+    ww->left = window;
+    ww->binary = len > 4 && strcmp(fn + len - 4, ".bin") == 0;
+    ww->fp = strcmp(fn, "-") == 0 ? stdout : fopen(fn, "wb");
+    if (!ww->fp) {
+        fprintf(stderr, "Cannot open %s\n", fn);
+        return -1;
+    }
+    if (ww->binary)
+        fwrite(WINDOW_BIN_MAGIC, 1, WINDOW_BIN_MAGIC_LEN, ww->fp);
+    else
+        fprintf(ww->fp, "accesses,hits,misses,evictions\n");
+    return 0;
+}
+
+/*
+ * windowSplit - Count data accesses up to the end of the window
+ */
+size_t windowSplit(window_writer_t* ww, const trace_access_t* accesses,
+                   size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n && ww->left > 0; i++) {
+        /* same access semantics as accessTrace() */
+        unsigned int count = accesses[i].op == 'M' ? 2
+                             : accesses[i].op != 'I';
+
+        ww->accesses += count;
+        ww->left = ww->left > count ? ww->left - count : 0;
+    }
+    return i;
+}
+
+/*
+ * emit - Write one row with the counts since the window started
+ */
+static void emit(window_writer_t* ww, const cache_t* cache)
+{
+    unsigned long long int row[4];
+
+    row[0] = ww->accesses;
+    row[1] = cache->hit_count - ww->hits;
+    row[2] = cache->miss_count - ww->misses;
+    row[3] = cache->eviction_count - ww->evictions;
+    if (ww->binary)
+        fwrite(row, sizeof(row[0]), 4, ww->fp);
+    else
+        fprintf(ww->fp, "%llu,%llu,%llu,%llu\n", row[0], row[1], row[2],
+                row[3]);
+    ww->hits = cache->hit_count;
+    ww->misses = cache->miss_count;
+    ww->evictions = cache->eviction_count;
+}
+
+/*
+ * windowEnd - Emit the window if it is complete
+ */
+void windowEnd(window_writer_t* ww, const cache_t* cache)
+{
+    if (ww->left > 0)
+        return;
+    emit(ww, cache);
+    ww->left = ww->window;
+}
+
+/*
+ * closeWindows - Emit the partial window and close the file
+ */
+int closeWindows(window_writer_t* ww, const cache_t* cache)
+{
+    int failed;
+
+    if (ww->left < ww->window)
+        emit(ww, cache);
+    failed = ferror(ww->fp);
+    if (ww->fp == stdout)
+        failed |= fflush(ww->fp);
+    else
+        failed |= fclose(ww->fp);
+    ww->fp = NULL;
+    if (failed) {
+        fprintf(stderr, "Cannot write the windows\n");
+        return -1;
+    }
+    return 0;
+}
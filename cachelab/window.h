@@ -0,0 +1,66 @@
+/*
+ * window.h - Time series of cache counters over fixed windows
+ *
+ * The replay is cut into windows of a fixed number of data accesses,
+ * counted like the hits and misses: loads and stores make one, modifies
+ * two and instruction fetches none.  A modify is never split, so a
+ * window it completes holds one access more.  The hits, misses and
+ * evictions of each window are written out as it ends, followed by
+ * the possibly shorter last window.  Rows hold the number of data
+ * accesses replayed so far and the counts of the window.  Two formats
+ * are written:
+ *
+ *   csv     A header line "accesses,hits,misses,evictions" and one
+ *           line per window.
+ *   binary  The 8 byte magic WINDOW_BIN_MAGIC followed by one record
+ *           of four 64-bit unsigned integers in host byte order per
+ *           window, in the order of the CSV columns.
+ */
+#ifndef CSIM_WINDOW_H
+#define CSIM_WINDOW_H
+
+#include <stdio.h>
+#include "cache.h"
+
+#define WINDOW_BIN_MAGIC "CSIMWIN1"
+#define WINDOW_BIN_MAGIC_LEN 8
+
+/* Type: Writer of the window series of one cache */
+typedef struct window_writer {
+    FILE* fp;
+    int binary;
+    unsigned long long int window;   /* data accesses per window */
+    unsigned long long int accesses; /* data accesses replayed so far */
+    unsigned long long int left;     /* data accesses left in this window */
+    unsigned long long int hits, misses, evictions; /* at window start */
+} window_writer_t;
+
+/*
+ * initWindows - Write windows of the given number of data accesses to
+ *     the file fn ("-" for stdout), in binary if fn ends in ".bin" and
+ *     as CSV otherwise.  Returns 0 on success or -1 after printing an
+ *     error.
+ */
+int initWindows(window_writer_t* ww, const char* fn,
+                unsigned long long int window);
+
+/*
+ * windowSplit - Number of the n records to replay before the current
+ *     window ends, all of them if it does not end among them
+ */
+size_t windowSplit(window_writer_t* ww, const trace_access_t* accesses,
+                   size_t n);
+
+/*
+ * windowEnd - Emit the window that just ended if the records passed to
+ *     windowSplit() completed it
+ */
+void windowEnd(window_writer_t* ww, const cache_t* cache);
+
+/*
+ * closeWindows - Emit the last, partial window and close the file.
+ *     Returns 0 on success or -1 after printing an error.
+ */
+int closeWindows(window_writer_t* ww, const cache_t* cache);
+
+#endif /* CSIM_WINDOW_H */